@@ -0,0 +1,566 @@
+// headless benchmark of the software renderer library. It renders a fixed suite of scenes at several resolutions,
+// with each triangle rasterization mode, and needs neither a window nor OpenGL.
+//
+// usage: srl_benchmark [--frames N] [--resolution WxH]... [--scene NAME]... [--layout NAME] [--golden FILE] [--write-golden FILE]
+//                      [--replay FILE]
+//   --frames N            frames timed per scene, resolution and mode (default 20)
+//   --resolution WxH      replaces the default resolutions (320x240, 1280x720 and 1920x1080)
+//   --scene NAME          only run the named scenes (plane, soup, tiny, huge, overdraw, tex-nearest, tex-bilinear,
+//                         tex-trilinear)
+//   --layout NAME         memory layout of the frame buffers (linear, tiled4, tiled8, morton), default linear.
+//                         The checksums are computed in row order, so they are the same for every layout
+//   --write-golden FILE   store the checksum of the last image of every run in FILE
+//   --golden FILE         compare the checksums with the ones stored in FILE, exit with 1 if any differs
+//   --replay FILE         instead of the scenes, render each frame of a capture (see srl::FrameCapture) with the
+//                         renderers, settings, size and layout it was captured with. The runs are named
+//                         "replay WxH frameN"
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "glmutils.h"
+#include "software_renderer_lib/srl_frame_buffer.h"
+#include "software_renderer_lib/srl_line_renderer.h"
+#include "software_renderer_lib/srl_point_renderer.h"
+#include "software_renderer_lib/srl_triangle_renderer.h"
+#include "software_renderer_lib/srl_texture.h"
+#include "software_renderer_lib/srl_frame_capture.h"
+#include "models.h"
+
+struct Scene;
+struct Mode;
+
+// scenes are built for a given resolution, so that sizes can be given in pixels
+typedef void (*SceneBuilder)(int width, int height, Scene &scene);
+
+// a list of draw calls, each one is a mesh and the transformations of its instances
+struct Scene {
+    struct Draw {
+        std::vector<srl::vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<glm::mat4> mvps;
+    };
+    std::vector<Draw> draws;
+    // when set, the scene is drawn with a TextureShader sampling it, instead of the color of the vertices
+    std::unique_ptr<srl::Texture> texture;
+
+    // triangles submitted per frame
+    unsigned long long triangles() const {
+        unsigned long long count = 0;
+        for (const Draw &draw : draws)
+            count += (draw.indices.empty() ? draw.vertices.size() : draw.indices.size()) / 3 * draw.mvps.size();
+        return count;
+    }
+};
+
+// triangle renderer configuration
+struct Mode {
+    const char *name;
+    srl::TriangleRenderer::RasterMode rasterMode;
+    bool binned;
+    bool hierarchicalZ;
+    bool visibilityBuffer;
+    // draw the scene twice, depth only and then the color of the pixels at the depth of the first pass
+    bool zPrepass;
+};
+
+void buildPlane(int width, int height, Scene &scene);
+void buildSoup(int width, int height, Scene &scene);
+void buildTiny(int width, int height, Scene &scene);
+void buildHuge(int width, int height, Scene &scene);
+void buildOverdraw(int width, int height, Scene &scene);
+void buildTexNearest(int width, int height, Scene &scene);
+void buildTexBilinear(int width, int height, Scene &scene);
+void buildTexTrilinear(int width, int height, Scene &scene);
+
+// a renderer of each type, to replay the draws of a capture
+struct Replayer {
+    srl::PointRenderer points;
+    srl::LineRenderer lines;
+    srl::TriangleRenderer triangles;
+};
+
+template<class Renderer>
+void renderFrame(Renderer &renderer, const Scene &scene, bool zPrepass, srl::FrameBuffer<uint32_t> &fb, srl::FrameBuffer<float> &db);
+void renderCapturedFrame(Replayer &replayer, const srl::FrameCapture &capture, const srl::FrameCapture::Frame &frame,
+                         srl::FrameBuffer<uint32_t> &fb, srl::FrameBuffer<float> &db);
+uint64_t checksum(const srl::FrameBuffer<uint32_t> &fb, const srl::FrameBuffer<float> &db);
+bool parseLayout(const char *name, srl::BufferLayout &layout);
+bool readGolden(const char *path, std::map<std::string, uint64_t> &golden);
+
+const struct { const char *name; SceneBuilder build; } scenes[] = {
+        {"plane", buildPlane},       // the plane of models.h, many instances of it
+        {"soup", buildSoup},         // large triangles of random size, position and depth
+        {"tiny", buildTiny},         // many triangles of about a pixel
+        {"huge", buildHuge},         // a few triangles much larger than the screen
+        {"overdraw", buildOverdraw}, // full screen layers drawn back to front, every fragment passes the depth test
+        // a checkerboard floor up to the horizon, so the texture goes from magnified to minified down to its last
+        // mip level, with each filter
+        {"tex-nearest", buildTexNearest},
+        {"tex-bilinear", buildTexBilinear},
+        {"tex-trilinear", buildTexTrilinear}
+};
+
+const Mode modes[] = {
+        {"scanline", srl::TriangleRenderer::RasterMode::Scanline, false, false, false, false},
+        {"halfspace", srl::TriangleRenderer::RasterMode::HalfSpace, false, false, false, false},
+        {"binned", srl::TriangleRenderer::RasterMode::HalfSpace, true, false, false, false},
+        {"binned-hiz", srl::TriangleRenderer::RasterMode::HalfSpace, true, true, false, false},
+        {"visibility", srl::TriangleRenderer::RasterMode::HalfSpace, true, false, true, false},
+        {"prepass", srl::TriangleRenderer::RasterMode::HalfSpace, true, false, false, true}
+};
+
+
+int main(int argc, char **argv) {
+    int frames = 20;
+    std::vector<std::pair<int, int> > resolutions;
+    std::vector<std::string> sceneFilter;
+    const char *goldenPath = nullptr, *writeGoldenPath = nullptr, *replayPath = nullptr;
+    srl::BufferLayout layout = srl::BufferLayout::Linear;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        int width, height;
+        if (!strcmp(argv[i], "--frames") && hasValue)
+            frames = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--resolution") && hasValue && sscanf(argv[++i], "%dx%d", &width, &height) == 2)
+            resolutions.push_back(std::make_pair(width, height));
+        else if (!strcmp(argv[i], "--scene") && hasValue)
+            sceneFilter.push_back(argv[++i]);
+        else if (!strcmp(argv[i], "--layout") && hasValue && parseLayout(argv[i + 1], layout))
+            i++;
+        else if (!strcmp(argv[i], "--golden") && hasValue)
+            goldenPath = argv[++i];
+        else if (!strcmp(argv[i], "--write-golden") && hasValue)
+            writeGoldenPath = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && hasValue)
+            replayPath = argv[++i];
+        else {
+            printf("usage: %s [--frames N] [--resolution WxH]... [--scene NAME]... [--layout NAME] [--golden FILE] [--write-golden FILE] [--replay FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (resolutions.empty())
+        resolutions = {{320, 240}, {1280, 720}, {1920, 1080}};
+
+    std::map<std::string, uint64_t> golden;
+    if (goldenPath && !readGolden(goldenPath, golden)) {
+        printf("could not read %s\n", goldenPath);
+        return 2;
+    }
+    srl::FrameCapture capture;
+    if (replayPath) {
+        try {
+            capture.load(replayPath);
+        }
+        catch (const std::runtime_error &error) {
+            printf("%s\n", error.what());
+            return 2;
+        }
+    }
+    std::ofstream goldenOut;
+    if (writeGoldenPath)
+        goldenOut.open(writeGoldenPath);
+
+    int mismatches = 0;
+    printf("%-13s %-11s %-11s %10s %10s %10s %18s\n", "scene", "resolution", "mode", "ms/frame", "Mtri/s", "Mpix/s", "checksum");
+
+    // print a run, and compare the checksum of its last image with the golden one
+    auto report = [&](const char *sceneName, const char *modeName, const srl::FrameBuffer<uint32_t> &fb, const srl::FrameBuffer<float> &db,
+                      double seconds, unsigned long long triangles, const srl::PipelineStats &stats) {
+        double msPerFrame = seconds * 1000.0 / frames;
+        double mtriPerSecond = triangles * frames / seconds * 1e-6;
+        double mpixPerSecond = double(fb.width()) * fb.height() * frames / seconds * 1e-6;
+
+        // the name of the run identifies its checksum in the golden file
+        char resolutionName[32], runName[128];
+        snprintf(resolutionName, sizeof(resolutionName), "%dx%d", fb.width(), fb.height());
+        snprintf(runName, sizeof(runName), "%s %s %s", sceneName, resolutionName, modeName);
+        uint64_t hash = checksum(fb, db);
+
+        const char *goldenStatus = "";
+        if (goldenPath) {
+            auto it = golden.find(runName);
+            if (it == golden.end())
+                goldenStatus = " (no golden)";
+            else if (it->second != hash) {
+                goldenStatus = " MISMATCH";
+                mismatches++;
+            }
+        }
+        if (goldenOut.is_open())
+            goldenOut << runName << " " << std::hex << hash << std::dec << "\n";
+
+        printf("%-13s %-11s %-11s %10.3f %10.2f %10.2f   %016llx%s\n", sceneName, resolutionName, modeName,
+               msPerFrame, mtriPerSecond, mpixPerSecond, (unsigned long long) hash, goldenStatus);
+        if (srl::PipelineStats::ENABLED) {
+            // stats of the last frame
+            printf("    ");
+            stats.writeJson(std::cout);
+            std::cout << std::endl;
+        }
+    };
+
+    if (replayPath) {
+        for (unsigned int i = 0; i < capture.frames().size(); i++) {
+            const srl::FrameCapture::Frame &frame = capture.frames()[i];
+            srl::FrameBuffer<uint32_t> fb(frame.width, frame.height, frame.layout);
+            srl::FrameBuffer<float> db(frame.width, frame.height, frame.layout);
+            // the primitives of the points and lines are counted as triangles too, a third of their vertices
+            unsigned long long triangles = 0;
+            for (const srl::FrameCapture::Draw &draw : frame.draws)
+                triangles += (draw.indexList == srl::FrameCapture::NO_INDICES ? capture.vertexList(draw.vertexList).size() :
+                              capture.indexList(draw.indexList).size()) / 3 * draw.mvps.size();
+
+            Replayer replayer;
+            renderCapturedFrame(replayer, capture, frame, fb, db);
+
+            auto start = std::chrono::steady_clock::now();
+            for (int repeat = 0; repeat < frames; repeat++)
+                renderCapturedFrame(replayer, capture, frame, fb, db);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            char modeName[32];
+            snprintf(modeName, sizeof(modeName), "frame%u", i);
+            report("replay", modeName, fb, db, elapsed.count(), triangles, replayer.triangles.pipelineStats());
+        }
+    }
+    else {
+        for (auto &sceneInfo : scenes) {
+            if (!sceneFilter.empty() && std::find(sceneFilter.begin(), sceneFilter.end(), sceneInfo.name) == sceneFilter.end())
+                continue;
+
+            for (auto &resolution : resolutions) {
+                int width = resolution.first, height = resolution.second;
+                Scene scene;
+                sceneInfo.build(width, height, scene);
+                srl::FrameBuffer<uint32_t> fb(width, height, layout);
+                srl::FrameBuffer<float> db(width, height, layout);
+
+                for (const Mode &mode : modes) {
+                    auto run = [&](auto &renderer) {
+                        renderer.m_rasterMode = decltype(renderer.m_rasterMode)(mode.rasterMode);
+                        renderer.m_binned = mode.binned;
+                        renderer.m_hierarchicalZ = mode.hierarchicalZ;
+                        renderer.m_visibilityBuffer = mode.visibilityBuffer;
+
+                        // warm up (memory of the frame arena, thread pool, caches)
+                        renderFrame(renderer, scene, mode.zPrepass, fb, db);
+
+                        auto start = std::chrono::steady_clock::now();
+                        for (int frame = 0; frame < frames; frame++)
+                            renderFrame(renderer, scene, mode.zPrepass, fb, db);
+                        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                        report(sceneInfo.name, mode.name, fb, db, elapsed.count(), scene.triangles(), renderer.pipelineStats());
+                    };
+                    if (scene.texture) {
+                        srl::BasicTriangleRenderer<srl::TextureShader> renderer;
+                        renderer.m_shader.m_texture = scene.texture.get();
+                        run(renderer);
+                    }
+                    else {
+                        srl::TriangleRenderer renderer;
+                        run(renderer);
+                    }
+                }
+            }
+        }
+    }
+
+    if (goldenPath)
+        printf("%d checksum mismatches\n", mismatches);
+    return mismatches ? 1 : 0;
+}
+
+
+template<class Renderer>
+void renderFrame(Renderer &renderer, const Scene &scene, bool zPrepass, srl::FrameBuffer<uint32_t> &fb, srl::FrameBuffer<float> &db) {
+    renderer.beginFrame();
+    fb.fastClear(srl::color::grey().getRGBA32());
+    db.fastClear(1.0f);
+    auto drawScene = [&]() {
+        for (const Scene::Draw &draw : scene.draws) {
+            if (draw.indices.empty())
+                renderer.render(draw.vertices, draw.mvps, fb, db);
+            else
+                renderer.render(draw.vertices, draw.indices, draw.mvps, fb, db);
+        }
+    };
+    if (zPrepass) {
+        renderer.m_passMode = srl::PassMode::DepthOnly;
+        drawScene();
+        renderer.m_passMode = srl::PassMode::EqualDepth;
+        drawScene();
+        renderer.m_passMode = srl::PassMode::Color;
+    }
+    else {
+        drawScene();
+    }
+    renderer.endFrame();
+}
+
+// the draws of a captured frame, in the order they were recorded. The settings of each draw are loaded in the
+// renderer of its type before drawing it
+void renderCapturedFrame(Replayer &replayer, const srl::FrameCapture &capture, const srl::FrameCapture::Frame &frame,
+                         srl::FrameBuffer<uint32_t> &fb, srl::FrameBuffer<float> &db) {
+    srl::Renderer *renderers[] = {&replayer.points, &replayer.lines, &replayer.triangles};
+    for (srl::Renderer *renderer : renderers)
+        renderer->beginFrame();
+    fb.fastClear(frame.clearColor);
+    db.fastClear(frame.clearDepth);
+
+    for (const srl::FrameCapture::Draw &draw : frame.draws) {
+        srl::Renderer *renderer = renderers[int(draw.state.type)];
+        renderer->loadState(draw.state);
+        const std::vector<srl::vertex> &vts = capture.vertexList(draw.vertexList);
+        bool indexed = draw.indexList != srl::FrameCapture::NO_INDICES;
+
+        if (draw.depthOnly) {
+            // only the triangle renderer renders without a color buffer
+            for (const glm::mat4 &mvp : draw.mvps) {
+                if (indexed)
+                    replayer.triangles.renderDepth(vts, capture.indexList(draw.indexList), mvp, db);
+                else
+                    replayer.triangles.renderDepth(vts, mvp, db);
+            }
+        }
+        else if (indexed)
+            renderer->render(vts, capture.indexList(draw.indexList), draw.mvps, fb, db);
+        else
+            renderer->render(vts, draw.mvps, fb, db);
+    }
+
+    for (srl::Renderer *renderer : renderers)
+        renderer->endFrame();
+}
+
+bool parseLayout(const char *name, srl::BufferLayout &layout) {
+    static const std::pair<const char *, srl::BufferLayout> layouts[] = {
+            {"linear", srl::BufferLayout::Linear},
+            {"tiled4", srl::BufferLayout::Tiled4x4},
+            {"tiled8", srl::BufferLayout::Tiled8x8},
+            {"morton", srl::BufferLayout::Morton}
+    };
+    for (auto &entry : layouts)
+        if (!strcmp(name, entry.first)) {
+            layout = entry.second;
+            return true;
+        }
+    return false;
+}
+
+// FNV-1a of the color and depth buffers, in row order
+uint64_t checksum(const srl::FrameBuffer<uint32_t> &fb, const srl::FrameBuffer<float> &db) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&](uint32_t value) {
+        for (int byte = 0; byte < 4; byte++) {
+            hash ^= (value >> (byte * 8)) & 0xffu;
+            hash *= 1099511628211ull;
+        }
+    };
+    const uint32_t *colors = fb.linear();
+    const float *depths = db.linear();
+    for (unsigned int i = 0, size = fb.width() * fb.height(); i < size; i++) {
+        uint32_t depthBits;
+        memcpy(&depthBits, &depths[i], sizeof(depthBits));
+        add(colors[i]);
+        add(depthBits);
+    }
+    return hash;
+}
+
+// golden file, one "scene resolution mode checksum" line per run
+bool readGolden(const char *path, std::map<std::string, uint64_t> &golden) {
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string scene, resolution, mode, hash;
+    while (in >> scene >> resolution >> mode >> hash)
+        golden[scene + " " + resolution + " " + mode] = strtoull(hash.c_str(), nullptr, 16);
+    return true;
+}
+
+
+// deterministic random numbers, the same on every platform (unlike the std distributions),
+// so that the golden checksums do not depend on the standard library
+struct Random {
+    uint32_t state;
+
+    explicit Random(uint32_t seed) : state(seed) {}
+
+    // uniform in [0, 1)
+    float next() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+    float range(float min, float max) { return min + (max - min) * next(); }
+};
+
+srl::vertex makeVertex(float x, float y, float z, const srl::color &col) {
+    srl::vertex v;
+    v.pos = glm::vec4(x, y, z, 1.f);
+    v.col = col;
+    return v;
+}
+
+srl::color randomColor(Random &random) {
+    return {random.range(.2f, 1.f), random.range(.2f, 1.f), random.range(.2f, 1.f), 1.f};
+}
+
+// add a triangle with clockwise winding, the front facing one, so that none of them is back-face culled
+void addTriangle(std::vector<srl::vertex> &vts, srl::vertex a, srl::vertex b, srl::vertex c) {
+    float area = (b.pos.x - a.pos.x) * (c.pos.y - a.pos.y) - (c.pos.x - a.pos.x) * (b.pos.y - a.pos.y);
+    if (area > 0)
+        std::swap(b, c);
+    vts.push_back(a); vts.push_back(b); vts.push_back(c);
+}
+
+// random triangles with positions in normalized device coordinates (identity mvp), and sizes in pixels
+void addRandomTriangles(int width, int height, int count, float minSize, float maxSize, uint32_t seed, Scene &scene) {
+    Random random(seed);
+    Scene::Draw draw;
+    draw.mvps.push_back(glm::mat4(1.f));
+    draw.vertices.reserve(count * 3);
+    float pixelX = 2.f / width, pixelY = 2.f / height;
+    for (int i = 0; i < count; i++) {
+        float x = random.range(-1.f, 1.f), y = random.range(-1.f, 1.f), z = random.range(-.9f, .9f);
+        float size = random.range(minSize, maxSize);
+        srl::color col = randomColor(random);
+        srl::vertex v[3];
+        for (auto &vtx : v)
+            vtx = makeVertex(x + random.range(-.5f, .5f) * size * pixelX, y + random.range(-.5f, .5f) * size * pixelY,
+                             z + random.range(-.05f, .05f), col);
+        addTriangle(draw.vertices, v[0], v[1], v[2]);
+    }
+    scene.draws.push_back(draw);
+}
+
+void buildPlane(int width, int height, Scene &scene) {
+    glm::mat4 viewProj = glm::perspectiveFovRH_NO<float>(glm::radians(50.0f), (float) width, (float) height, .5f, 5.0f) *
+                         glm::lookAt<float>(glm::vec3(.0f, .0f, 2.5f), glm::vec3(.0f, .0f, .0f), glm::vec3(.0f, 1.f, .0f));
+
+    // a grid of planes, each one slightly rotated
+    const int grid = 8;
+    std::vector<glm::mat4> mvps;
+    for (int y = 0; y < grid; y++)
+        for (int x = 0; x < grid; x++) {
+            glm::vec3 offset((x - (grid - 1) * .5f) * .4f, (y - (grid - 1) * .5f) * .4f, 0.f);
+            mvps.push_back(viewProj * glm::translate(offset.x, offset.y, offset.z) * glm::rotate(.3f + .1f * (x + y * grid), glm::vec3(1.f, 1.f, 0.f)) *
+                           glm::scale(.6f, .6f, .6f));
+        }
+
+    auto addMesh = [&](const std::vector<float> &positions, const std::vector<float> &colors, const std::vector<unsigned int> &indices) {
+        Scene::Draw draw;
+        for (unsigned int i = 0; i < positions.size() / 3; i++)
+            draw.vertices.push_back(makeVertex(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2],
+                                               {colors[i * 4], colors[i * 4 + 1], colors[i * 4 + 2], colors[i * 4 + 3]}));
+        draw.indices = indices;
+        draw.mvps = mvps;
+        scene.draws.push_back(draw);
+    };
+    addMesh(planeBodyVertices, planeBodyColors, planeBodyIndices);
+    addMesh(planeWingVertices, planeWingColors, planeWingIndices);
+    addMesh(planePropellerVertices, planePropellerColors, planePropellerIndices);
+}
+
+void buildSoup(int width, int height, Scene &scene) {
+    addRandomTriangles(width, height, 20000, 10.f, 100.f, 1, scene);
+}
+
+void buildTiny(int width, int height, Scene &scene) {
+    addRandomTriangles(width, height, 200000, .5f, 3.f, 2, scene);
+}
+
+void buildHuge(int width, int height, Scene &scene) {
+    // 3 to 10 times the size of the screen, most of each one is outside of it
+    addRandomTriangles(width, height, 16, 3.f * std::max(width, height), 10.f * std::max(width, height), 3, scene);
+}
+
+void buildOverdraw(int width, int height, Scene &scene) {
+    // full screen quads from the back to the front, the worst case for the depth test
+    const int layers = 32;
+    Random random(4);
+    Scene::Draw draw;
+    draw.mvps.push_back(glm::mat4(1.f));
+    for (int layer = 0; layer < layers; layer++) {
+        float z = .9f - 1.8f * layer / (layers - 1);
+        srl::color col = randomColor(random);
+        srl::vertex bl = makeVertex(-1.f, -1.f, z, col), br = makeVertex(1.f, -1.f, z, col);
+        srl::vertex tr = makeVertex(1.f, 1.f, z, col), tl = makeVertex(-1.f, 1.f, z, col);
+        addTriangle(draw.vertices, bl, br, tr);
+        addTriangle(draw.vertices, bl, tr, tl);
+    }
+    scene.draws.push_back(draw);
+}
+
+// a 256x256 checkerboard of 8x8 texel squares, each dark square with its own color, so that every mip level
+// down to 1x1 is different
+std::unique_ptr<srl::Texture> makeCheckerboard(srl::TextureFilter filter) {
+    const unsigned int size = 256, square = 8;
+    Random random(5);
+    std::vector<uint32_t> squareColors((size / square) * (size / square));
+    for (uint32_t &col : squareColors)
+        col = randomColor(random).getRGBA32();
+    std::vector<uint32_t> texels(size * size);
+    for (unsigned int y = 0; y < size; y++)
+        for (unsigned int x = 0; x < size; x++) {
+            unsigned int sx = x / square, sy = y / square;
+            texels[y * size + x] = (sx + sy) & 1 ? srl::color::white().getRGBA32() : squareColors[sy * (size / square) + sx];
+        }
+    std::unique_ptr<srl::Texture> texture(new srl::Texture(size, size, texels.data()));
+    texture->m_filter = filter;
+    texture->m_wrap = srl::TextureWrap::Repeat;
+    return texture;
+}
+
+// a grid of quads on the floor (y = -1), from under the camera to far away, with the texture repeated across it
+void buildTexturedFloor(int width, int height, srl::TextureFilter filter, Scene &scene) {
+    glm::mat4 viewProj = glm::perspectiveFovRH_NO<float>(glm::radians(60.0f), (float) width, (float) height, .1f, 100.0f) *
+                         glm::lookAt<float>(glm::vec3(.0f, .0f, .0f), glm::vec3(.0f, -.2f, -1.f), glm::vec3(.0f, 1.f, .0f));
+
+    const int quads = 32;
+    const float extent = 80.f, repeats = 64.f;
+    Scene::Draw draw;
+    for (int z = 0; z <= quads; z++)
+        for (int x = 0; x <= quads; x++) {
+            float u = float(x) / quads, v = float(z) / quads;
+            srl::vertex vtx = makeVertex((u - .5f) * extent, -1.f, -v * extent, srl::color::white());
+            vtx.uv = glm::vec2(u, v) * repeats;
+            draw.vertices.push_back(vtx);
+        }
+    // two triangles per quad, clockwise seen from above
+    for (int z = 0; z < quads; z++)
+        for (int x = 0; x < quads; x++) {
+            unsigned int i = z * (quads + 1) + x;
+            unsigned int quad[6] = {i, i + quads + 1, i + 1, i + 1, i + quads + 1, i + quads + 2};
+            draw.indices.insert(draw.indices.end(), quad, quad + 6);
+        }
+    draw.mvps.push_back(viewProj);
+    scene.draws.push_back(draw);
+    scene.texture = makeCheckerboard(filter);
+}
+
+void buildTexNearest(int width, int height, Scene &scene) {
+    buildTexturedFloor(width, height, srl::TextureFilter::Nearest, scene);
+}
+
+void buildTexBilinear(int width, int height, Scene &scene) {
+    buildTexturedFloor(width, height, srl::TextureFilter::Bilinear, scene);
+}
+
+void buildTexTrilinear(int width, int height, Scene &scene) {
+    buildTexturedFloor(width, height, srl::TextureFilter::Trilinear, scene);
+}
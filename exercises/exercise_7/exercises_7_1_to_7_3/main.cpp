@@ -24,6 +24,7 @@ void key_input_callback(GLFWwindow* window, int button, int other, int action, i
 unsigned int setup();
 glm::mat4 trackballRotation();
 void cursorInNdc(float screenX, float screenY, int screenW, int screenH, float &x, float &y);
+void loadVertices(const std::vector<float> &positions, const std::vector<float> &colors, std::vector<srl::vertex> &outVts);
 
 // screen settings
 const unsigned int SCR_WIDTH = 512;
@@ -47,6 +48,14 @@ srl::Renderer *srlRenderer = &triangleR;
 
 bool clipPrimitives = true;
 bool cullBackFaces = true;
+bool binnedTriangles = false;
+bool halfSpaceTriangles = false;
+bool materializeFragments = false;
+bool hierarchicalZ = false;
+bool printStats = false;
+// record the draws of the next frame in frame.srlc, to replay them in srl_benchmark (--replay)
+bool captureFrame = false;
+srl::FrameCapture frameCapture;
 
 
 int main()
@@ -107,7 +116,7 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     // give our frame buffer to opengl
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.buffer());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.linear());
 
 
     unsigned int depthTexture;
@@ -121,7 +130,7 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     // give our frame buffer to opengl
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, zBuffer.buffer());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, zBuffer.linear());
 
 
 
@@ -130,46 +139,19 @@ int main()
     VAO = setup();
 
     // NEW!
-    // load objects into vectors
+    // load objects into vectors, one vertex per position/color pair, and the indices of the triangles
     std::vector<srl::vertex> vtsBody, vtsWingRight, vtsWingLeft, vtsProp;
-    std::vector<float> points;
-    std::vector<float> colors;
-    indicesToValueArray(planeBodyVertices, planeBodyIndices, 3, points);
-    indicesToValueArray(planeBodyColors, planeBodyIndices, 4, colors);
-    for (unsigned int i = 0; i < points.size()/3; i++){
-        srl::vertex v;
-        v.pos = glm::vec4(points[i*3], points[i*3+1], points[i*3+2], 1.0f);
-        v.col = {colors[i*4], colors[i*4+1], colors[i*4+2], colors[i*4+3]};
-        vtsBody.push_back(v);
-    }
-
-    points.clear(); colors.clear();
-    indicesToValueArray(planeWingVertices, planeWingIndices, 3, points);
-    indicesToValueArray(planeWingColors, planeWingIndices, 4, colors);
-    for (unsigned int i = 0; i < points.size()/3; i++){
-        srl::vertex v;
-        v.pos = glm::vec4(points[i*3], points[i*3+1], points[i*3+2], 1.0f);
-        v.col = {colors[i*4], colors[i*4+1], colors[i*4+2], colors[i*4+3]};
-        vtsWingRight.push_back(v);
-    }
+    std::vector<unsigned int> idxBody = planeBodyIndices, idxWingRight = planeWingIndices, idxWingLeft, idxProp = planePropellerIndices;
+    loadVertices(planeBodyVertices, planeBodyColors, vtsBody);
+    loadVertices(planeWingVertices, planeWingColors, vtsWingRight);
+    loadVertices(planePropellerVertices, planePropellerColors, vtsProp);
 
     // we need to invert the order of vertices of the left wing due to the winding order and back face culling
-    for (int i = vtsWingRight.size()-1; i >= 0; i--){
-        srl::vertex v = vtsWingRight[i];
+    for (auto v : vtsWingRight){
         v.pos.x = -v.pos.x;
         vtsWingLeft.push_back(v);
     }
-
-    // load the propeller
-    points.clear(); colors.clear();
-    indicesToValueArray(planePropellerVertices, planePropellerIndices, 3, points);
-    indicesToValueArray(planePropellerColors, planePropellerIndices, 4, colors);
-    for (unsigned int i = 0; i < points.size()/3; i++){
-        srl::vertex v;
-        v.pos = glm::vec4(points[i*3], points[i*3+1], points[i*3+2], 1.0f);
-        v.col = {colors[i*4], colors[i*4 + 1], colors[i*4 + 2], colors[i*4 + 3]};
-        vtsProp.push_back(v);
-    }
+    idxWingLeft.assign(idxWingRight.rbegin(), idxWingRight.rend());
 
 
 
@@ -203,6 +185,17 @@ int main()
     std::cout << "3 - use triangle renderer" << std::endl;
     std::cout << "4 - toggle clipping" << std::endl;
     std::cout << "5 - toggle backface culling (triangles only)" << std::endl;
+    std::cout << "6 - toggle binned multi-threaded rasterization (triangles only)" << std::endl;
+    std::cout << "7 - toggle scanline/half-space rasterizer (triangles only)" << std::endl;
+    std::cout << "8 - toggle storing fragments in a list before writing them (debugging)" << std::endl;
+    std::cout << "9 - toggle hierarchical z-buffer occlusion (triangles only)" << std::endl;
+    std::cout << "0 - print the pipeline statistics of the current renderer (build with SRL_PIPELINE_STATS)" << std::endl;
+    std::cout << "C - capture the next frame in frame.srlc (replay it with srl_benchmark --replay frame.srlc)" << std::endl;
+
+    // renderers, and transformations of the two instances of each wing, declared here to avoid
+    // allocating memory in the render loop
+    srl::Renderer *renderers[] = {&pointR, &lineR, &triangleR};
+    std::vector<glm::mat4> wingRightInstances(2), wingLeftInstances(2);
 
     // render loop
     while (!glfwWindowShouldClose(window)) {
@@ -211,18 +204,29 @@ int main()
         std::chrono::duration<float> appTime = frameStart - begin;
 
         // SOFTWARE RENDERER LIB part
-        // clear buffers
+        // the scratch memory of the renderers is released at the end of the frame
+        for (auto renderer : renderers)
+            renderer->beginFrame();
+
+        // clear buffers, lazily: the tiles are only filled when they are first drawn to, or when uploaded to opengl
         srl::color clearColor = srl::color::grey();
-        buffer.clearBuffer(clearColor.getRGBA32());
-        zBuffer.clearBuffer(1.0f);
+        buffer.fastClear(clearColor.getRGBA32());
+        zBuffer.fastClear(1.0f);
+
+        bool capturing = captureFrame;
+        if (capturing) {
+            frameCapture.beginFrame(buffer.width(), buffer.height(), buffer.layout(), clearColor.getRGBA32(), 1.0f);
+            for (auto renderer : renderers)
+                renderer->m_capture = &frameCapture;
+            captureFrame = false;
+        }
 
         // set model view projection (mvp) transformation
         glm::mat4 mvp = viewProj * trackballRotation() * storedRotation;
 
         // render the body and right wing of the plane to our frame buffer using our graphics library.
         mvp = mvp * glm::scale(3.f, 3.f, 3.f) * glm::rotate(glm::pi<float>(), glm::vec3(0.f, 1.f, 0.f));
-        srlRenderer->render(vtsBody, mvp, buffer, zBuffer);
-        srlRenderer->render(vtsWingRight, mvp, buffer, zBuffer);
+        srlRenderer->render(vtsBody, idxBody, mvp, buffer, zBuffer);
 
         // TODO render the propeller (and the rest of the plane)
         glm::mat4 propeller = mvp * glm::translate(.0f, .5f, .0f) *
@@ -230,26 +234,54 @@ int main()
                               glm::rotate(glm::half_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f)) *
                               glm::scale(.5f, .5f, .5f);
 
-        srlRenderer->render(vtsProp, propeller, buffer, zBuffer);
+        srlRenderer->render(vtsProp, idxProp, propeller, buffer, zBuffer);
 
         // left wing back,
         // half size -> move to the back
         glm::mat4 wingRightBack = mvp * glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(.5f, .5f, .5f);
-        srlRenderer->render(vtsWingRight, wingRightBack, buffer, zBuffer);
 
         // right wing,
         // mirror in x
         glm::mat4 wingLeft = mvp;
-        srlRenderer->render(vtsWingLeft, wingLeft, buffer, zBuffer);
 
         // right wing back,
         // half size + mirror in x -> move to the back
         glm::mat4 wingLeftBack = mvp * glm::translate(0.0f, -0.5f, 0.0f) * glm::scale(.5f, .5f, .5f);
-        srlRenderer->render(vtsWingLeft, wingLeftBack, buffer, zBuffer);
+
+        // each wing mesh is drawn twice, as two instances in a single call
+        wingRightInstances[0] = mvp; wingRightInstances[1] = wingRightBack;
+        wingLeftInstances[0] = wingLeft; wingLeftInstances[1] = wingLeftBack;
+        srlRenderer->render(vtsWingRight, idxWingRight, wingRightInstances, buffer, zBuffer);
+        srlRenderer->render(vtsWingLeft, idxWingLeft, wingLeftInstances, buffer, zBuffer);
 
         // draw screen border
         lineR.render(screenFrame, glm::mat4(1.f), buffer, zBuffer);
 
+        if (printStats) {
+            if (srl::PipelineStats::ENABLED)
+                srlRenderer->pipelineStats().writeJson(std::cout);
+            else
+                std::cout << "pipeline statistics are disabled, build with SRL_PIPELINE_STATS defined";
+            std::cout << std::endl;
+            printStats = false;
+        }
+
+        for (auto renderer : renderers)
+            renderer->endFrame();
+
+        if (capturing) {
+            for (auto renderer : renderers)
+                renderer->m_capture = nullptr;
+            try {
+                frameCapture.save("frame.srlc");
+                std::cout << "frame captured in frame.srlc" << std::endl;
+            }
+            catch (const std::runtime_error &error) {
+                std::cout << error.what() << std::endl;
+            }
+            frameCapture.clear();
+        }
+
 
 
 
@@ -263,7 +295,7 @@ int main()
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, srlTexture);
         // upload the color buffer
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.buffer());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.linear());
         // render as a square of the size of the screen
         shader->use();
         shader->setMat4("mvp", glm::mat4(1.0f));
@@ -276,7 +308,7 @@ int main()
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, depthTexture);
         // upload the depth buffer, 32bits float in the red channel
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, zBuffer.buffer());
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, zBuffer.linear());
         // render on the top right corner
         shader->use();
         shader->setMat4("mvp", glm::translate(0.7f, 0.7f, 0.0f) * glm::scale(0.3f, 0.3f, 0.3f));
@@ -298,6 +330,10 @@ int main()
     }
     delete shader;
 
+    std::cout << "Most scratch memory used in a frame (point, line, triangle renderer): "
+              << pointR.frameArena().highWaterMark() << ", " << lineR.frameArena().highWaterMark() << ", "
+              << triangleR.frameArena().highWaterMark() << " bytes" << std::endl;
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     glfwTerminate();
     return 0;
@@ -389,6 +425,17 @@ void cursorInNdc(float screenX, float screenY, int screenW, int screenH, float &
 }
 
 
+// create one vertex for each position (3 floats) and color (4 floats)
+void loadVertices(const std::vector<float> &positions, const std::vector<float> &colors, std::vector<srl::vertex> &outVts){
+    for (unsigned int i = 0; i < positions.size()/3; i++){
+        srl::vertex v;
+        v.pos = glm::vec4(positions[i*3], positions[i*3+1], positions[i*3+2], 1.0f);
+        v.col = {colors[i*4], colors[i*4+1], colors[i*4+2], colors[i*4+3]};
+        outVts.push_back(v);
+    }
+}
+
+
 
 void cursor_input_callback(GLFWwindow* window, double posX, double posY){
     if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS){
@@ -443,6 +490,31 @@ void key_input_callback(GLFWwindow* window, int button, int other,int action, in
         cullBackFaces = !cullBackFaces;
         triangleR.m_cullBackFaces = cullBackFaces;
     }
+    if (button == GLFW_KEY_6 && action == GLFW_PRESS) {
+        binnedTriangles = !binnedTriangles;
+        triangleR.m_binned = binnedTriangles;
+    }
+    if (button == GLFW_KEY_7 && action == GLFW_PRESS) {
+        halfSpaceTriangles = !halfSpaceTriangles;
+        triangleR.m_rasterMode = halfSpaceTriangles ? srl::TriangleRenderer::RasterMode::HalfSpace :
+                                                      srl::TriangleRenderer::RasterMode::Scanline;
+    }
+    if (button == GLFW_KEY_8 && action == GLFW_PRESS) {
+        materializeFragments = !materializeFragments;
+        pointR.m_materializeFragments = materializeFragments;
+        lineR.m_materializeFragments = materializeFragments;
+        triangleR.m_materializeFragments = materializeFragments;
+    }
+    if (button == GLFW_KEY_9 && action == GLFW_PRESS) {
+        hierarchicalZ = !hierarchicalZ;
+        triangleR.m_hierarchicalZ = hierarchicalZ;
+    }
+    if (button == GLFW_KEY_0 && action == GLFW_PRESS) {
+        printStats = true;
+    }
+    if (button == GLFW_KEY_C && action == GLFW_PRESS) {
+        captureFrame = true;
+    }
 
 }
 
@@ -23,7 +23,7 @@ edge_rasterizer::~edge_rasterizer()
 /*
  * Initializes the edge_rasterizer with one edge
  */
-void edge_rasterizer::init(srl::vertex v1, srl::vertex v2)
+void edge_rasterizer::init(const glm::vec4 &v1, const glm::vec4 &v2)
 {
     m_v1 = v1;
     m_v2 = v2;
@@ -35,7 +35,7 @@ void edge_rasterizer::init(srl::vertex v1, srl::vertex v2)
 /*
  * Initializes the edge_rasterizer with two edges
  */
-void edge_rasterizer::init(srl::vertex v1, srl::vertex v2, srl::vertex v3)
+void edge_rasterizer::init(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3)
 {
     m_v1 = v1;
     m_v2 = v2;
@@ -64,10 +64,6 @@ bool edge_rasterizer::more_fragments() const
  */
 void edge_rasterizer::next_fragment()
 {
-    // TODO
-    // interpolate along the line here ~ one line of code
-    m_current = m_current + m_step;
-
     this->y_current += this->y_step;
 
     if (this->y_current < this->y_stop)
@@ -110,19 +106,14 @@ int edge_rasterizer::y() const
 }
 
 
-srl::vertex edge_rasterizer::getCurrent(){
-    return m_current;
-}
-
-
 /*
  * Initializes an edge, so it is ready to be scanconverted
  * \return - true if slope of the edge != 0 , false if the edge is horizontal
  */
-bool edge_rasterizer::init_edge(srl::vertex v1, srl::vertex v2)
+bool edge_rasterizer::init_edge(const glm::vec4 &v1, const glm::vec4 &v2)
 {
-    this->x_start = int(v1.pos.x + 0.5f); this->y_start = int(v1.pos.y + 0.5f);
-    this->x_stop  = int(v2.pos.x + 0.5f); this->y_stop  = int(v2.pos.y + 0.5f);
+    this->x_start = int(v1.x + 0.5f); this->y_start = int(v1.y + 0.5f);
+    this->x_stop  = int(v2.x + 0.5f); this->y_stop  = int(v2.y + 0.5f);
     this->x_current = this->x_start; this->y_current = this->y_start;
 
     int dx = this->x_stop - this->x_start;
@@ -137,12 +128,6 @@ bool edge_rasterizer::init_edge(srl::vertex v1, srl::vertex v2)
 
     this->valid = (this->y_current < this->y_stop);
 
-
-    // TODO
-    // initialize the vertex variables used for interpolation ~ 3 lines (I deleted m_start and reduced to 2 lines)
-    m_current = v1;
-    m_step = (v2 - v1) / float(dy);
-
     return this->valid;
 }
 
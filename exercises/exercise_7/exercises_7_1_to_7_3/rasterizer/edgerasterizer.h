@@ -6,12 +6,14 @@
 #include <stdexcept>
 #include <fstream>
 #include <sstream>
-#include "software_renderer_lib/srl_types.h"
+#include <glm/glm.hpp>
 
 /**
  * \class edge_rasterizer
  * A class which scanconverts an edge in a polygon. It computes the pixels which
  * are closest to the ideal edge, i.e.e either on the edge or to the right of the edge.
+ * Only the pixels are computed, the attributes of the vertices are interpolated by whoever
+ * uses the pixels (e.g. with plane equations).
  */ 
 class edge_rasterizer {
 public:
@@ -28,12 +30,12 @@ public:
     /**
      * Initializes the edge_rasterizer with one edge
      */
-    void init(srl::vertex v1, srl::vertex v2);
+    void init(const glm::vec4 &v1, const glm::vec4 &v2);
     
     /**
      * Initializes the edge_rasterizer with two edges
      */
-    void init(srl::vertex v1, srl::vertex v2, srl::vertex v3);
+    void init(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3);
 
     /**
      * Checks if there are fragments/pixels on the edge ready for use
@@ -62,14 +64,12 @@ public:
      */
     int y() const;
 
-    srl::vertex getCurrent();
-
 private:
     /**
      * Initializes an edge, so it is ready to be scanconverted
      * \return - true if slope of the edge != 0 , false if the edge is horizontal
      */
-    bool init_edge(srl::vertex v1, srl::vertex v2);
+    bool init_edge(const glm::vec4 &v1, const glm::vec4 &v2);
 
     /**
      * Computes the next fragment/pixel on the edge
@@ -110,13 +110,10 @@ private:
     int Denominator;
     int Accumulator;
 
-    srl::vertex m_v1, m_v2, m_v3;
-
-    // TODO
-    // use these variables for interpolation
-    srl::vertex m_current;
-    srl::vertex m_step;
-
+    /**
+     * Screen space positions of the vertices
+     */
+    glm::vec4 m_v1, m_v2, m_v3;
 
 };
 
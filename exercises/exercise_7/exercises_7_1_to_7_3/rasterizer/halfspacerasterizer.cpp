@@ -0,0 +1,240 @@
+#include "halfspacerasterizer.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HALFSPACE_USE_SSE
+#include <emmintrin.h>
+#endif
+
+/*
+ * \class halfspace_rasterizer
+ * A class which scanconverts a triangle using its three edge functions (half-spaces).
+ */
+
+namespace {
+    // vertices are snapped to the pixel grid like in the triangle_rasterizer, int(x + .5f),
+    // and kept in a range where the edge functions can be computed exactly with 64 bits integers
+    int64_t snap(float value) {
+        const float limit = float(1 << 24);
+        return int64_t(std::max(-limit, std::min(limit, value)) + .5f);
+    }
+
+    // division rounding towards -infinity
+    int floor_div(int value, int divisor) {
+        return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+}
+
+/*
+ * Parameterized constructor creates an instance of a half-space rasterizer which only
+ * generates the pixels inside the scissor rectangle [x_min, x_max] x [y_min, y_max]
+ */
+halfspace_rasterizer::halfspace_rasterizer(const glm::vec4 &p1, const glm::vec4 &p2, const glm::vec4 &p3,
+                                           int x_min, int y_min, int x_max, int y_max)
+    : block_max(nullptr), block_stride(0), valid(false)
+{
+    int64_t px[3] = {snap(p1.x), snap(p2.x), snap(p3.x)};
+    int64_t py[3] = {snap(p1.y), snap(p2.y), snap(p3.y)};
+
+    // twice the signed area, positive if the vertices are in counterclockwise order
+    int64_t area = (px[1] - px[0]) * (py[2] - py[0]) - (py[1] - py[0]) * (px[2] - px[0]);
+    if (area == 0)
+        return;
+
+    // visit the vertices in counterclockwise order, so that the edge functions are positive inside
+    int order[3] = {0, 1, 2};
+    if (area < 0) {
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+    inv_area = 1.0f / float(area);
+
+    // edge i goes from order[i+1] to order[i+2], it is zero at these vertices and equals
+    // twice the area at vertex order[i], so E_i / area is the barycentric weight of vertex order[i]
+    for (int i = 0; i < 3; i++) {
+        int from = order[(i + 1) % 3];
+        int to = order[(i + 2) % 3];
+        int64_t ea = py[from] - py[to];
+        int64_t eb = px[to] - px[from];
+        int e = order[i];
+        this->a[e] = int(ea);
+        this->b[e] = int(eb);
+        this->c[e] = px[from] * py[to] - py[from] * px[to];
+        // fill rule: left edges (going down) and bottom edges (going right) are inside, others are not
+        this->bias[e] = (ea > 0 || (ea == 0 && eb > 0)) ? 0 : 1;
+    }
+
+    // depth plane, z = z3 + (z1 - z3) * w1 + (z2 - z3) * w2
+    double dz1 = double(p1.z) - p3.z;
+    double dz2 = double(p2.z) - p3.z;
+    double inv = 1.0 / double(area);
+    this->dzdx = (dz1 * this->a[0] + dz2 * this->a[1]) * inv;
+    this->dzdy = (dz1 * this->b[0] + dz2 * this->b[1]) * inv;
+    this->z0 = p3.z + (dz1 * double(this->c[0]) + dz2 * double(this->c[1])) * inv;
+    this->z_min = std::min({p1.z, p2.z, p3.z});
+
+    // bounding box of the triangle, clipped by the scissor rectangle
+    this->x_min = int(std::max<int64_t>(x_min, std::min({px[0], px[1], px[2]})));
+    this->x_max = int(std::min<int64_t>(x_max, std::max({px[0], px[1], px[2]})));
+    this->y_min = int(std::max<int64_t>(y_min, std::min({py[0], py[1], py[2]})));
+    this->y_max = int(std::min<int64_t>(y_max, std::max({py[0], py[1], py[2]})));
+
+    // blocks are aligned to multiples of BLOCK_SIZE, so that they never cross a screen tile
+    this->bx_start   = floor_div(this->x_min, BLOCK_SIZE) * BLOCK_SIZE;
+    this->bx_current = this->bx_start;
+    this->by_current = floor_div(this->y_min, BLOCK_SIZE) * BLOCK_SIZE;
+
+    this->valid = (this->x_min <= this->x_max) && (this->y_min <= this->y_max);
+}
+
+/*
+ * Checks if there are more blocks which may be covered by the triangle
+ * \return true if there are more blocks, else false is returned
+ */
+bool halfspace_rasterizer::more_blocks() const
+{
+    return this->valid;
+}
+
+/*
+ * Computes the next block with at least one pixel inside the triangle
+ * \param b - the block which is filled with the coverage mask
+ * \return true if a block was found, false if there are no more blocks
+ */
+bool halfspace_rasterizer::next_block(block &blk)
+{
+    const int last = BLOCK_SIZE - 1;
+
+    while (this->valid) {
+        int x = this->bx_current;
+        int y = this->by_current;
+
+        // advance to the next block, row by row
+        this->bx_current += BLOCK_SIZE;
+        if (this->bx_current > this->x_max) {
+            this->bx_current = this->bx_start;
+            this->by_current += BLOCK_SIZE;
+            this->valid = (this->by_current <= this->y_max);
+        }
+
+        // trivial reject and trivial accept, using the corners of the block where each edge function
+        // has its largest and smallest values
+        bool reject = false;
+        bool full = true;
+        int64_t e0[3];
+        for (int e = 0; e < 3; e++) {
+            e0[e] = int64_t(this->a[e]) * x + int64_t(this->b[e]) * y + this->c[e];
+            int64_t eMax = e0[e] + int64_t(std::max(this->a[e], 0) + std::max(this->b[e], 0)) * last;
+            int64_t eMin = e0[e] + int64_t(std::min(this->a[e], 0) + std::min(this->b[e], 0)) * last;
+            reject |= (eMax < this->bias[e]);
+            full &= (eMin >= this->bias[e]);
+        }
+        if (reject || occluded(x, y))
+            continue;
+
+        // pixels of the block inside the scissor rectangle and bounding box
+        uint64_t rect = ~0ull;
+        if (x < this->x_min || x + last > this->x_max || y < this->y_min || y + last > this->y_max) {
+            uint64_t row = 0;
+            for (int i = 0; i < BLOCK_SIZE; i++)
+                if (x + i >= this->x_min && x + i <= this->x_max)
+                    row |= 1ull << i;
+            rect = 0;
+            for (int j = 0; j < BLOCK_SIZE; j++)
+                if (y + j >= this->y_min && y + j <= this->y_max)
+                    rect |= row << (j * BLOCK_SIZE);
+            full = false;
+        }
+
+        // the pixels of a full block do not need to be tested
+        uint64_t mask = ~0ull;
+        if (!full) {
+            mask = 0;
+#ifdef HALFSPACE_USE_SSE
+            // evaluate the three edge functions for four pixels at a time
+            __m128 edge[3], stepX[3], rowStep[3], bias[3];
+            for (int e = 0; e < 3; e++) {
+                float fa = float(this->a[e]);
+                edge[e] = _mm_add_ps(_mm_set1_ps(float(e0[e])), _mm_set_ps(3 * fa, 2 * fa, fa, 0.f));
+                stepX[e] = _mm_set1_ps(4 * fa);
+                rowStep[e] = _mm_set1_ps(float(this->b[e]));
+                bias[e] = _mm_set1_ps(float(this->bias[e]));
+            }
+
+            for (int j = 0; j < BLOCK_SIZE; j++) {
+                __m128 row[3] = {edge[0], edge[1], edge[2]};
+                for (int i = 0; i < BLOCK_SIZE; i += 4) {
+                    __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(row[0], bias[0]), _mm_cmpge_ps(row[1], bias[1])),
+                                               _mm_cmpge_ps(row[2], bias[2]));
+                    mask |= uint64_t(_mm_movemask_ps(inside)) << (j * BLOCK_SIZE + i);
+                    for (int e = 0; e < 3; e++)
+                        row[e] = _mm_add_ps(row[e], stepX[e]);
+                }
+                for (int e = 0; e < 3; e++)
+                    edge[e] = _mm_add_ps(edge[e], rowStep[e]);
+            }
+#else
+            for (int j = 0; j < BLOCK_SIZE; j++) {
+                for (int i = 0; i < BLOCK_SIZE; i++) {
+                    int64_t e[3];
+                    for (int k = 0; k < 3; k++)
+                        e[k] = e0[k] + int64_t(this->a[k]) * i + int64_t(this->b[k]) * j;
+                    if (e[0] >= this->bias[0] && e[1] >= this->bias[1] && e[2] >= this->bias[2])
+                        mask |= 1ull << (j * BLOCK_SIZE + i);
+                }
+            }
+#endif
+        }
+        mask &= rect;
+        if (mask == 0)
+            continue;
+
+        blk.x = x;
+        blk.y = y;
+        blk.mask = mask;
+        blk.full = full;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Skips the blocks where the triangle is behind the depth buffer
+ */
+void halfspace_rasterizer::set_depth_bounds(const float *block_max, int stride)
+{
+    this->block_max = block_max;
+    this->block_stride = stride;
+}
+
+/*
+ * Checks if the triangle is behind the depth buffer in the whole block with lower left pixel (x, y)
+ */
+bool halfspace_rasterizer::occluded(int x, int y) const
+{
+    if (!this->block_max || x < 0 || y < 0)
+        return false;
+
+    // the plane has its smallest value in the block at one of the corners, but outside of the triangle
+    // it can go below the depth of the vertices, so we use whichever bound is closer
+    const int last = BLOCK_SIZE - 1;
+    double zBlock = this->dzdx * x + this->dzdy * y + this->z0
+                    + (std::min(this->dzdx, 0.0) + std::min(this->dzdy, 0.0)) * last;
+    float zNear = std::max(float(zBlock), this->z_min);
+
+    // interpolating in float may give fragments a bit closer than the exact plane
+    const float epsilon = 1e-5f;
+    return zNear - epsilon >= this->block_max[(y / BLOCK_SIZE) * this->block_stride + x / BLOCK_SIZE];
+}
+
+/*
+ * Computes the barycentric coordinates of pixel (x, y), the weights of the three vertices
+ */
+glm::vec3 halfspace_rasterizer::barycentrics(int x, int y) const
+{
+    glm::vec3 w;
+    for (int e = 0; e < 3; e++)
+        w[e] = float(int64_t(this->a[e]) * x + int64_t(this->b[e]) * y + this->c[e]) * this->inv_area;
+    return w;
+}
@@ -0,0 +1,129 @@
+#ifndef __HALFSPACE_H__
+#define __HALFSPACE_H__
+
+#include <cstdint>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+/**
+ * \class halfspace_rasterizer
+ * A class which scanconverts a triangle using its three edge functions (half-spaces).
+ * Instead of walking the pixels one by one, it visits the triangle in square blocks of
+ * BLOCK_SIZE x BLOCK_SIZE pixels. Blocks outside the triangle are skipped, blocks completely
+ * inside of it are accepted without testing each pixel, and the other blocks are tested
+ * four pixels at a time with SSE.
+ * The vertices are snapped to the pixel grid in the same way as in the triangle_rasterizer,
+ * and pixels on the left and bottom edges belong to the triangle, while pixels on the right
+ * and top edges do not.
+ */
+class halfspace_rasterizer {
+public:
+
+    static const int BLOCK_SIZE = 8;
+
+    /**
+     * A block of pixels generated by the rasterizer
+     */
+    struct block {
+        /**
+         * Coordinates of the lower left pixel of the block
+         */
+        int x;
+        int y;
+
+        /**
+         * Coverage mask, bit (j * BLOCK_SIZE + i) is set if pixel (x + i, y + j) is inside the triangle
+         */
+        uint64_t mask;
+
+        /**
+         * True if all the pixels of the block are inside the triangle (mask has all bits set)
+         */
+        bool full;
+    };
+
+    /**
+     * Parameterized constructor creates an instance of a half-space rasterizer which only
+     * generates the pixels inside the scissor rectangle [x_min, x_max] x [y_min, y_max].
+     * Only the screen space positions of the vertices are needed, the rasterizer only computes the
+     * coverage, the attributes are interpolated by whoever uses the pixels (see srl::TrianglePlanes)
+     */
+    halfspace_rasterizer(const glm::vec4 &p1, const glm::vec4 &p2, const glm::vec4 &p3,
+                         int x_min = std::numeric_limits<int>::min() / 2, int y_min = std::numeric_limits<int>::min() / 2,
+                         int x_max = std::numeric_limits<int>::max() / 2, int y_max = std::numeric_limits<int>::max() / 2);
+
+    /**
+     * Checks if there are more blocks which may be covered by the triangle
+     * \return true if there are more blocks, else false is returned
+     */
+    bool more_blocks() const;
+
+    /**
+     * Computes the next block with at least one pixel inside the triangle
+     * \param b - the block which is filled with the coverage mask
+     * \return true if a block was found, false if there are no more blocks
+     */
+    bool next_block(block &b);
+
+    /**
+     * Computes the barycentric coordinates of pixel (x, y), the weights of the three vertices
+     */
+    glm::vec3 barycentrics(int x, int y) const;
+
+    /**
+     * Skips the blocks where the triangle is behind the depth buffer. block_max[by * stride + bx] must be
+     * the farthest depth stored in the pixels of block (bx, by), the block with lower left pixel
+     * (bx * BLOCK_SIZE, by * BLOCK_SIZE). The depth of the triangle is the interpolated pos.z of its vertices
+     * \param block_max - max depth of each block, or nullptr to disable the test
+     * \param stride - number of blocks in a row of block_max
+     */
+    void set_depth_bounds(const float *block_max, int stride);
+
+private:
+
+    /**
+     * Checks if the triangle is behind the depth buffer in the whole block with lower left pixel (x, y)
+     */
+    bool occluded(int x, int y) const;
+
+    /**
+     * The edge functions E(x, y) = a * x + b * y + c, positive inside of the triangle.
+     * The bias is subtracted from E to exclude pixels on the right and top edges
+     */
+    int a[3];
+    int b[3];
+    int64_t c[3];
+    int bias[3];
+
+    /**
+     * One over twice the area of the triangle, used to compute barycentric coordinates
+     */
+    float inv_area;
+
+    /**
+     * The depth of the triangle as a plane, z(x, y) = dzdx * x + dzdy * y + z0, its smallest value
+     * inside the triangle, and the max depth of each block of the depth buffer
+     */
+    double dzdx, dzdy, z0;
+    float z_min;
+    const float *block_max;
+    int block_stride;
+
+    /**
+     * The rectangle of pixels we visit (bounding box of the triangle clipped by the scissor rectangle)
+     */
+    int x_min, y_min;
+    int x_max, y_max;
+
+    /**
+     * The current block
+     */
+    int bx_start;
+    int bx_current;
+    int by_current;
+
+    bool valid;
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <algorithm>
 
 #include "glmutils.h"
 #include "software_renderer_lib/srl_types.h"
@@ -15,13 +16,16 @@
  * \class LineRasterizer
  * A class which scanconverts a straight line. It computes the pixels such that they are as close to the
  * the ideal line as possible.
+ * Vertex is the type of the vertices interpolated along the line, it needs the operators + and - between
+ * vertices, and * and / by a float (e.g. srl::shaded_vertex).
  */ 
+template<class Vertex>
 class LineRasterizer {
 public:
     /**
      * Parameterized constructor creates an instance of a line rasterizer
      */
-    LineRasterizer(srl::vertex v1, srl::vertex v2);
+    LineRasterizer(Vertex v1, Vertex v2);
 
     /**
      * Destroys the current instance of the line rasterizer
@@ -62,7 +66,45 @@ public:
      */
     int y() const;
 
-    srl::vertex GetCurrent();
+    Vertex GetCurrent();
+
+
+    /**
+     * Span interface, an alternative to MoreFragments/NextFragment (use one or the other). The pixels of the
+     * line come in runs: pixels of the same row for x-dominant lines, of the same column for y-dominant lines.
+     * The pixels of a span are span_x(), span_y() plus i * (span_dx(), span_dy()), for i in [0, span_length()),
+     * and their vertex is SpanStart() + SpanStep() * i
+     * \return true if there are more spans of the line, else false is returned
+     */
+    bool MoreSpans() const;
+
+    /**
+     * Computes the next span of the line
+     */
+    void NextSpan();
+
+    /**
+     * The first pixel of the current span
+     */
+    int span_x() const;
+    int span_y() const;
+
+    /**
+     * The number of pixels of the current span
+     */
+    int span_length() const;
+
+    /**
+     * The step from one pixel of a span to the next, (x_step, 0) for x-dominant lines, (0, y_step) otherwise
+     */
+    int span_dx() const;
+    int span_dy() const;
+
+    /**
+     * The vertex at the first pixel of the current span, and its change from one pixel to the next
+     */
+    Vertex SpanStart() const;
+    Vertex SpanStep() const;
 
 private:
     /**
@@ -80,6 +122,11 @@ private:
      */
     void y_dominant_innerloop();
 
+    /**
+     * Computes the length of the span that starts at the current pixel
+     */
+    void begin_span();
+
     /**
      * Private Variables
      */
@@ -127,6 +174,13 @@ private:
      */
     bool left_right;
     bool valid;
+    bool x_dominant;
+
+    /**
+     * Pixels of the current span, and how many pixels of the line came before it
+     */
+    int  span_pixels;
+    int  span_first;
 
     /**
      * A pointer to a member function which runs the inner loop of the algorithm
@@ -138,13 +192,315 @@ private:
     /**
      * start and stop vertex
      */
-    srl::vertex m_start;
-    srl::vertex m_stop;
+    Vertex m_start;
+    Vertex m_stop;
 
     // used for interpolation
-    srl::vertex m_step;
-    srl::vertex m_current;
+    Vertex m_step;
+    Vertex m_current;
 
 };
 
+/*
+ * \class LineRasterizer
+ * A class which scanconverts a straight line. It computes the pixels such that they are as close to the
+ * the ideal line as possible.
+ */ 
+
+/*
+ * Parameterized constructor creates an instance of a line rasterizer
+ * \param x1 - the x-coordinate of the first vertex
+ * \param y1 - the y-coordinate of the first vertex
+ * \param x2 - the x-coordinate of the second vertex
+ * \param y2 - the y-coordinate of the second vertex
+ */
+/*LineRasterizer::LineRasterizer(int x1, int y1, int x2, int y2)
+{
+    this->initialize_line(x1, y1, x2, y2);
+}*/
+template<class Vertex>
+LineRasterizer<Vertex>::LineRasterizer(Vertex v1, Vertex v2){
+    m_start=v1;
+    m_stop=v2;
+    this->initialize_line();
+}
+
+/*
+ * Destroys the current instance of the line rasterizer
+ */
+template<class Vertex>
+LineRasterizer<Vertex>::~LineRasterizer()
+{}
+
+
+/*
+ * Checks if there are fragments/pixels of the line ready for use
+ * \return true if there are more fragments of the line, else false is returned
+ */
+template<class Vertex>
+bool LineRasterizer<Vertex>::MoreFragments() const
+{
+    return this->valid;
+}
+
+/*
+ * Computes the next fragment of the line
+ */
+template<class Vertex>
+void LineRasterizer<Vertex>::NextFragment()
+{
+    // Run the innerloop once
+    // Dereference the pointer to the private member function 
+    // It looks strange; but this is the way it is done!
+    (this->*innerloop)();
+}
+
+/*
+ * Returns a vector which contains all the pixels of the line
+ */
+template<class Vertex>
+std::vector<glm::ivec2> LineRasterizer<Vertex>::AllFragments(){
+    std::vector<glm::ivec2> points;
+
+    while (this->MoreFragments()) {
+        points.push_back(glm::ivec2(this->x(), this->y()));
+        this->NextFragment();
+    }
+
+    return points;
+}
+
+
+/*
+ * Returns the current x-coordinate of the current fragment/pixel of the line
+ * It is only valid to call this function if "more_fragments()" returns true,
+ * else a "runtime_error" exception is thrown
+ * \return The x-coordinate of the current line fragment/pixel
+ */
+template<class Vertex>
+int LineRasterizer<Vertex>::x() const
+{
+    if (!this->valid) {
+	    throw std::runtime_error("LineRasterizer::x(): Invalid State");
+    }
+    return this->x_current;
+}
+
+/*
+ * Returns the current y-coordinate of the current fragment/pixel of the line
+ * It is only valid to call this function if "more_fragments()" returns true,
+ * else a "runtime_error" exception is thrown
+ * \return The y-coordinate of the current line fragment/pixel
+ */
+template<class Vertex>
+int LineRasterizer<Vertex>::y() const
+{
+    if (!this->valid) {
+	    throw std::runtime_error("LineRasterizer::y(): Invalid State");
+    }
+    return this->y_current;
+}
+
+template<class Vertex>
+Vertex LineRasterizer<Vertex>::GetCurrent()
+{
+    return this->m_current;
+}
+
+template<class Vertex>
+bool LineRasterizer<Vertex>::MoreSpans() const
+{
+    return this->valid;
+}
+
+/*
+ * Computes the next span of the line, the state ends as if NextFragment had been called once per pixel of the span
+ */
+template<class Vertex>
+void LineRasterizer<Vertex>::NextSpan()
+{
+    int &major = this->x_dominant ? this->x_current : this->y_current;
+    int &minor = this->x_dominant ? this->y_current : this->x_current;
+    int major_step = this->x_dominant ? this->x_step : this->y_step;
+    int minor_step = this->x_dominant ? this->y_step : this->x_step;
+    int major_stop = this->x_dominant ? this->x_stop : this->y_stop;
+    int abs_2major = this->x_dominant ? this->abs_2dx : this->abs_2dy;
+    int abs_2minor = this->x_dominant ? this->abs_2dy : this->abs_2dx;
+
+    // the steps inside the span only move along the major axis
+    major   += (this->span_pixels - 1) * major_step;
+    this->d += (this->span_pixels - 1) * abs_2minor;
+    this->span_first += this->span_pixels;
+
+    if ((this->valid = (major != major_stop))) {
+        // the step to the next span also moves along the minor axis
+        minor   += minor_step;
+        major   += major_step;
+        this->d += abs_2minor - abs_2major;
+        this->begin_span();
+    }
+}
+
+template<class Vertex>
+int LineRasterizer<Vertex>::span_x() const
+{
+    return this->x_current;
+}
+
+template<class Vertex>
+int LineRasterizer<Vertex>::span_y() const
+{
+    return this->y_current;
+}
+
+template<class Vertex>
+int LineRasterizer<Vertex>::span_length() const
+{
+    return this->span_pixels;
+}
+
+template<class Vertex>
+int LineRasterizer<Vertex>::span_dx() const
+{
+    return this->x_dominant ? this->x_step : 0;
+}
+
+template<class Vertex>
+int LineRasterizer<Vertex>::span_dy() const
+{
+    return this->x_dominant ? 0 : this->y_step;
+}
+
+/*
+ * The vertex of a span is computed from the start of the line, so that the error does not build up along it
+ */
+template<class Vertex>
+Vertex LineRasterizer<Vertex>::SpanStart() const
+{
+    return this->m_start + this->m_step * float(this->span_first);
+}
+
+template<class Vertex>
+Vertex LineRasterizer<Vertex>::SpanStep() const
+{
+    return this->m_step;
+}
+
+/*
+ * Protected functions
+ */
+
+/*
+ * Private functions
+ */
+
+/*
+ * Initializes the LineRasterizer with the two vertices
+ */
+template<class Vertex>
+void LineRasterizer<Vertex>::initialize_line()
+{
+    this->x_start = m_start.pos.x + 0.5f;
+    this->y_start = m_start.pos.y + 0.5f;
+
+    this->x_stop = m_stop.pos.x + 0.5f;
+    this->y_stop = m_stop.pos.y + 0.5f;
+
+    this->x_current = this->x_start;
+    this->y_current = this->y_start;
+
+    this->dx = this->x_stop - this->x_start;
+    this->dy = this->y_stop - this->y_start;
+
+    this->abs_2dx = std::abs(this->dx) << 1; // 2 * |dx|
+    this->abs_2dy = std::abs(this->dy) << 1; // 2 * |dy|
+
+    this->x_step = (this->dx < 0) ? -1 : 1;
+    this->y_step = (this->dy < 0) ? -1 : 1;
+
+    m_current = m_start;
+
+    if (this->abs_2dx > this->abs_2dy) {
+        // the line is x-dominant
+        this->left_right = (this->x_step > 0);
+        this->d = this->abs_2dy - (this->abs_2dx >> 1);
+        this->valid = (this->x_start != this->x_stop);
+        this->innerloop = &LineRasterizer::x_dominant_innerloop;
+
+        m_step = (m_stop - m_start) / float(std::abs(this->dx));
+    }
+    else {
+        // the line is y-dominant
+        this->left_right = (this->y_step > 0);
+        this->d = this->abs_2dx - (this->abs_2dy >> 1);
+        this->valid = (this->y_start != this->y_stop);
+        this->innerloop = &LineRasterizer::y_dominant_innerloop;
+
+        m_step = (m_stop - m_start) / float(std::abs(this->dy));
+    }
+
+    this->x_dominant = (this->abs_2dx > this->abs_2dy);
+    this->span_first = 0;
+    if (this->valid)
+        this->begin_span();
+}
+
+/*
+ * Computes the length of the span that starts at the current pixel. Each step of the inner loops adds
+ * 2 * |minor delta| to d, and the step also moves along the minor axis (which ends the span) when d > 0, or
+ * d == 0 when left_right. So the number of steps that stay in the span has a closed form
+ */
+template<class Vertex>
+void LineRasterizer<Vertex>::begin_span()
+{
+    int remaining = this->x_dominant ? std::abs(this->x_stop - this->x_current) : std::abs(this->y_stop - this->y_current);
+    int abs_2minor = this->x_dominant ? this->abs_2dy : this->abs_2dx;
+
+    int steps = remaining;
+    if (abs_2minor > 0) {
+        if (this->left_right)
+            steps = this->d < 0 ? (abs_2minor - 1 - this->d) / abs_2minor : 0;
+        else
+            steps = this->d <= 0 ? -this->d / abs_2minor + 1 : 0;
+        steps = std::min(steps, remaining);
+    }
+    this->span_pixels = steps + 1;
+}
+
+/*
+ * Runs the x-dominant innerloop
+ */
+template<class Vertex>
+void LineRasterizer<Vertex>::x_dominant_innerloop()
+{
+    if ((this->valid = (this->x_current != this->x_stop))) {
+	    if (this->d > 0 || (this->d == 0 && this->left_right)) {
+            this->y_current += this->y_step;
+            this->d         -= this->abs_2dx;
+        }
+        this->x_current += this->x_step;
+        this->d         += this->abs_2dy;
+
+        m_current = m_current + m_step;
+    }
+}
+
+/*
+ * Runs the y-dominant innerloop
+ */
+template<class Vertex>
+void LineRasterizer<Vertex>::y_dominant_innerloop()
+{
+    if ((this->valid = (this->y_current != this->y_stop))) {
+        if (this->d > 0 || (this->d == 0 && this->left_right)) {
+            this->x_current += this->x_step;
+            this->d         -= this->abs_2dy;
+        }
+        this->y_current += this->y_step;
+        this->d         += this->abs_2dx;
+
+        m_current = m_current + m_step;
+    }
+}
+
 #endif
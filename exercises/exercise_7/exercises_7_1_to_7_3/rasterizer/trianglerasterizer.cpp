@@ -4,7 +4,20 @@
  * \class triangle_rasterizer
  * A class which scanconverts a triangle. It computes the pixels such that they are inside the triangle.
  */
-triangle_rasterizer::triangle_rasterizer(srl::vertex v1, srl::vertex v2, srl::vertex v3) : valid(false)
+triangle_rasterizer::triangle_rasterizer(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3) : valid(false),
+        clip_x_min(std::numeric_limits<int>::min()), clip_y_min(std::numeric_limits<int>::min()),
+        clip_x_max(std::numeric_limits<int>::max()), clip_y_max(std::numeric_limits<int>::max())
+{
+    this->initialize_triangle(v1, v2, v3);
+}
+
+/*
+ * Parameterized constructor creates an instance of a triangle rasterizer which only
+ * generates the fragments inside the scissor rectangle [x_min, x_max] x [y_min, y_max]
+ */
+triangle_rasterizer::triangle_rasterizer(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3,
+                                         int x_min, int y_min, int x_max, int y_max) : valid(false),
+        clip_x_min(x_min), clip_y_min(y_min), clip_x_max(x_max), clip_y_max(y_max)
 {
     this->initialize_triangle(v1, v2, v3);
 }
@@ -46,32 +59,46 @@ void triangle_rasterizer::next_fragment()
 {
     if (this->x_current < this->x_stop) {
         this->x_current += 1;
-        // TODO
-        // interpolate along the current scan line here ~ 1 line
-        m_current = m_current + m_step;
-
     }
     else {
+        this->next_scanline();
+    }
+}
+
+/*
+ * Sets up the current scanline using the left and right edges
+ * \return true if the scanline has fragments inside the scissor rectangle
+ */
+bool triangle_rasterizer::begin_scanline()
+{
+    this->x_start   = leftedge.x();
+    this->x_current = this->x_start;
+    this->x_stop    = rightedge.x() - 1;
+    this->y_current = leftedge.y();
+
+    if (this->y_current < this->clip_y_min)
+        return false;
+
+    // skip the fragments to the left and right of the scissor rectangle
+    if (this->x_current < this->clip_x_min)
+        this->x_current = this->clip_x_min;
+    if (this->x_stop > this->clip_x_max)
+        this->x_stop = this->clip_x_max;
+
+    return this->x_current <= this->x_stop;
+}
+
+/*
+ * Moves to the next scanline which has fragments inside the scissor rectangle
+ */
+void triangle_rasterizer::next_scanline()
+{
+    do {
         this->leftedge.next_fragment();
         this->rightedge.next_fragment();
-        while (this->leftedge.more_fragments() && (leftedge.x() >= rightedge.x())) {
-            leftedge.next_fragment();
-            rightedge.next_fragment();
-        }
-        this->valid = this->leftedge.more_fragments();
-        if (this->valid) {
-            this->x_start   = leftedge.x();
-            this->x_current = this->x_start;
-            this->x_stop    = rightedge.x() - 1;
-            this->y_current = leftedge.y();
-
-            // TODO
-            // reset the variables used for interpolation using the information of the current scanline ~ 2 lines
-            m_current = leftedge.getCurrent();
-            m_step = (this->rightedge.getCurrent() - this->leftedge.getCurrent()) / float(x_stop - x_start + 1);
-
-        }
-    }
+        // scanlines go bottom up, so we are done once we leave the scissor rectangle
+        this->valid = this->leftedge.more_fragments() && (this->leftedge.y() <= this->clip_y_max);
+    } while (this->valid && !this->begin_scanline());
 }
 
 /*
@@ -102,10 +129,27 @@ int triangle_rasterizer::y() const
     return this->y_current;
 }
 
-srl::vertex triangle_rasterizer::getCurrent() const{
-    return m_current;
+/*
+ * Returns the x-coordinate of the last fragment/pixel of the current scanline
+ * It is only valid to call this function if "more_fragments()" returns true,
+ * else a "runtime_error" exception is thrown
+ * \return The x-coordinate of the last fragment/pixel of the current scanline
+ */
+int triangle_rasterizer::x_end() const
+{
+    if (!this->valid) {
+        throw std::runtime_error("triangle_rasterizer::x_end(): Invalid State/Not Initialized");
+    }
+    return this->x_stop;
 }
 
+/*
+ * Skips the rest of the current scanline, and moves to the first fragment of the next one
+ */
+void triangle_rasterizer::next_span()
+{
+    this->next_scanline();
+}
 
 /*
  * Initializes the TriangleRasterizer with the three vertices
@@ -116,11 +160,11 @@ srl::vertex triangle_rasterizer::getCurrent() const{
  * \param x3 - the x-coordinate of the third vertex
  * \param y3 - the y-coordinate of the third vertex
  */
-void triangle_rasterizer::initialize_triangle(srl::vertex v1, srl::vertex v2, srl::vertex v3)
+void triangle_rasterizer::initialize_triangle(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3)
 {
-    this->ivertex[0] = glm::ivec2(v1.pos.x+.5f, v1.pos.y+.5f);
-    this->ivertex[1] = glm::ivec2(v2.pos.x+.5f, v2.pos.y+.5f);
-    this->ivertex[2] = glm::ivec2(v3.pos.x+.5f, v3.pos.y+.5f);
+    this->ivertex[0] = glm::ivec2(v1.x+.5f, v1.y+.5f);
+    this->ivertex[1] = glm::ivec2(v2.x+.5f, v2.y+.5f);
+    this->ivertex[2] = glm::ivec2(v3.x+.5f, v3.y+.5f);
     m_vertex[0] = v1;
     m_vertex[1] = v2;
     m_vertex[2] = v3;
@@ -132,9 +176,9 @@ void triangle_rasterizer::initialize_triangle(srl::vertex v1, srl::vertex v2, sr
     glm::ivec2 ll = this->ivertex[this->lower_left];
     glm::ivec2 ul = this->ivertex[this->upper_left];
     glm::ivec2 ot = this->ivertex[this->the_other];
-    srl::vertex llv = m_vertex[lower_left];
-    srl::vertex ulv = m_vertex[upper_left];
-    srl::vertex otv = m_vertex[the_other];
+    const glm::vec4 &llv = m_vertex[lower_left];
+    const glm::vec4 &ulv = m_vertex[upper_left];
+    const glm::vec4 &otv = m_vertex[the_other];
 
 
     // Let u be the vector from 'lower_left' to 'upper_left' vertices.
@@ -178,14 +222,10 @@ void triangle_rasterizer::initialize_triangle(srl::vertex v1, srl::vertex v2, sr
         this->x_stop    = this->rightedge.x() - 1;
         this->y_stop    = this->ivertex[this->upper_left].y;
 
-        // TODO
-        // initialize the variables used for interpolation with the information of the current scanline ~ 2 lines
-        m_current = this->leftedge.getCurrent();
-        m_step = (this->rightedge.getCurrent() - this->leftedge.getCurrent()) / float(x_stop - x_start + 1);
-
-        this->valid = (this->x_current <= this->x_stop);
-        if (!(this->valid)) {
-            this->next_fragment();
+        // set up the first scanline
+        this->valid = (this->y_current <= this->clip_y_max) && this->begin_scanline();
+        if (!(this->valid) && (this->y_current <= this->clip_y_max)) {
+            this->next_scanline();
         }
     }
 }
@@ -7,6 +7,7 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <limits>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/integer.hpp>
@@ -16,13 +17,21 @@
 /**
  * \class triangle_rasterizer
  * A class which scanconverts a triangle. It computes the pixels such that they are inside the triangle.
+ * Only the screen space positions of the vertices are needed, the other attributes are interpolated
+ * by whoever uses the pixels (see srl::TrianglePlanes).
  */ 
 class triangle_rasterizer {
 public:
     /**
      * Parameterized constructor creates an instance of a triangle rasterizer
      */
-    triangle_rasterizer(srl::vertex v1, srl::vertex v2, srl::vertex v3);
+    triangle_rasterizer(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3);
+
+    /**
+     * Parameterized constructor creates an instance of a triangle rasterizer which only
+     * generates the fragments inside the scissor rectangle [x_min, x_max] x [y_min, y_max]
+     */
+    triangle_rasterizer(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3, int x_min, int y_min, int x_max, int y_max);
 
     /**
      * Destroys the current instance of the triangle rasterizer
@@ -61,9 +70,19 @@ public:
      */
     int y() const;
 
+    /**
+     * Returns the x-coordinate of the last fragment/pixel of the current scanline, so that the
+     * fragments from x() to x_end() can be visited without calling next_fragment for each of them
+     * It is only valid to call this function if "more_fragments()" returns true,
+     * else a "runtime_error" exception is thrown
+     * \return The x-coordinate of the last fragment/pixel of the current scanline
+     */
+    int x_end() const;
 
-    srl::vertex getCurrent() const;
-
+    /**
+     * Skips the rest of the current scanline, and moves to the first fragment of the next one
+     */
+    void next_span();
 
 private:
 
@@ -71,7 +90,18 @@ private:
     /**
      * Initializes the TriangleRasterizer with the three vertices
      */
-    void initialize_triangle(srl::vertex v1, srl::vertex v2, srl::vertex v3);
+    void initialize_triangle(const glm::vec4 &v1, const glm::vec4 &v2, const glm::vec4 &v3);
+
+    /**
+     * Sets up the current scanline using the left and right edges
+     * \return true if the scanline has fragments inside the scissor rectangle
+     */
+    bool begin_scanline();
+
+    /**
+     * Moves to the next scanline which has fragments inside the scissor rectangle
+     */
+    void next_scanline();
 
 
     /**
@@ -90,7 +120,7 @@ private:
      * Stores the three vertices of the triangle
      */
     glm::ivec2 ivertex[3];
-    srl::vertex m_vertex[3];
+    glm::vec4 m_vertex[3];
 
     // Indices into the vertex table
     int lower_left;
@@ -119,10 +149,11 @@ private:
 
     bool valid;
 
-    // TODO
-    // use these variables for interpolation
-    srl::vertex m_step;
-    srl::vertex m_current;
+    // Scissor rectangle, fragments outside of it are skipped
+    int       clip_x_min;
+    int       clip_y_min;
+    int       clip_x_max;
+    int       clip_y_max;
 
 };
 
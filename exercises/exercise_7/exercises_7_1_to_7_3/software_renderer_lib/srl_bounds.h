@@ -0,0 +1,102 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLBOUNDS_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLBOUNDS_H
+
+#include <vector>
+#include <cstdint>
+#include "glm/glm.hpp"
+#include "srl_types.h"
+#include "srl_clip_space.h"
+
+namespace srl {
+
+    // where an object is with respect to the view volume
+    enum class Visibility {
+        Outside,    // nothing of it can be seen, it does not need to be drawn
+        Partial,    // it crosses at least one of the planes of the view volume
+        Inside      // all of it is in the view volume, its primitives do not need to be clipped
+    };
+
+    // axis aligned bounding box of the positions of a vertex list, in model space. The positions are
+    // points (w = 1), like the ones the vertex stage transforms
+    struct Bounds {
+        glm::vec3 min {1.f}, max {-1.f};
+
+        // the box of the positions of vts, empty if vts is empty
+        static Bounds of(const std::vector<vertex> &vts) {
+            Bounds bounds;
+            if (vts.empty())
+                return bounds;
+            bounds.min = bounds.max = glm::vec3(vts[0].pos);
+            for (const vertex &v : vts) {
+                bounds.min = glm::min(bounds.min, glm::vec3(v.pos));
+                bounds.max = glm::max(bounds.max, glm::vec3(v.pos));
+            }
+            return bounds;
+        }
+
+        inline bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+        // the corners of the box in clip space, tested against the view volume like the vertices (see OutCode).
+        // The view volume is convex, so the box is inside if all of its corners are, and it is outside if all
+        // of them are outside of the same plane. A box that is not outside might still be, near the corners
+        // of the view volume, that only costs drawing it
+        Visibility visibility(const glm::mat4 &mvp) const {
+            if (empty())
+                return Visibility::Outside;
+            uint8_t all = 0xff, any = 0;
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec4 pos = mvp * glm::vec4(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y,
+                                                corner & 4 ? max.z : min.z, 1.f);
+                uint8_t code = computeOutCode(pos.x, pos.y, pos.z, pos.w);
+                all &= code;
+                any |= code;
+            }
+            return all ? Visibility::Outside : any ? Visibility::Partial : Visibility::Inside;
+        }
+    };
+
+    // the bounds of the vertex lists drawn by a renderer, a vertex list is identified by its vector.
+    // Bounds given with attach are used as they are, until they are detached (so they must be given again if
+    // the vertices move). The others are computed from the positions on every call, a single pass over them,
+    // so they are always those of the current contents of the vector
+    class BoundsTable {
+    public:
+        void attach(const std::vector<vertex> *vts, const Bounds &bounds) {
+            for (Attached &attached : m_attached)
+                if (attached.vts == vts) {
+                    attached.bounds = bounds;
+                    return;
+                }
+            m_attached.push_back(Attached {vts, bounds});
+        }
+
+        void detach(const std::vector<vertex> *vts) {
+            for (unsigned int i = 0; i < m_attached.size(); i++)
+                if (m_attached[i].vts == vts) {
+                    m_attached.erase(m_attached.begin() + i);
+                    return;
+                }
+        }
+
+        // the bounds of vts, valid until the next call
+        const Bounds &bounds(const std::vector<vertex> &vts) {
+            for (const Attached &attached : m_attached)
+                if (attached.vts == &vts)
+                    return attached.bounds;
+            m_computed = Bounds::of(vts);
+            return m_computed;
+        }
+
+    private:
+        struct Attached {
+            const std::vector<vertex> *vts;
+            Bounds bounds;
+        };
+
+        std::vector<Attached> m_attached;
+        Bounds m_computed;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLBOUNDS_H
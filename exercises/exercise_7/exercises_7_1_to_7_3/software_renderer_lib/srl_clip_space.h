@@ -0,0 +1,127 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLCLIPSPACE_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLCLIPSPACE_H
+
+#include <vector>
+#include <cstdint>
+#include "glm/glm.hpp"
+#include "srl_types.h"
+#include "srl_frame_arena.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SRL_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace srl {
+
+    // outcode bits, set when a clip space position is outside of the corresponding plane of the view volume
+    // (-w <= x <= w, -w <= y <= w, -w <= z <= w)
+    enum OutCode : uint8_t {
+        OUT_LEFT   = 1 << 0, // x < -w
+        OUT_RIGHT  = 1 << 1, // x > w
+        OUT_BOTTOM = 1 << 2, // y < -w
+        OUT_TOP    = 1 << 3, // y > w
+        OUT_NEAR   = 1 << 4, // z < -w
+        OUT_FAR    = 1 << 5  // z > w
+    };
+
+    // output of the vertex stage, the clip space positions in structure of arrays form, so that
+    // they can be transformed and tested against the view volume four vertices at a time.
+    // The outcodes tell the clipping stage which primitives are trivially inside or outside
+    struct ClipSpaceVertices {
+        ArenaVector<float> x, y, z, w;
+        ArenaVector<uint8_t> outcode;
+
+        inline unsigned int size() const { return (unsigned int) outcode.size(); }
+
+        // allocate the arrays in arena (from then on, resizing them does not touch the heap)
+        void prepare(FrameArena &arena) {
+            arena.prepare(x); arena.prepare(y); arena.prepare(z); arena.prepare(w);
+            arena.prepare(outcode);
+        }
+
+        void resize(unsigned int size) {
+            x.resize(size); y.resize(size); z.resize(size); w.resize(size);
+            outcode.resize(size);
+        }
+
+        inline glm::vec4 position(unsigned int i) const { return glm::vec4(x[i], y[i], z[i], w[i]); }
+    };
+
+    // outcode of a single clip space position
+    inline uint8_t computeOutCode(float x, float y, float z, float w) {
+        return (x < -w ? OUT_LEFT : 0) | (x > w ? OUT_RIGHT : 0) |
+               (y < -w ? OUT_BOTTOM : 0) | (y > w ? OUT_TOP : 0) |
+               (z < -w ? OUT_NEAR : 0) | (z > w ? OUT_FAR : 0);
+    }
+
+    // transform the positions of vts by mvp into out, and compute their outcodes
+    inline void transformVertices(const std::vector<vertex> &vts, const glm::mat4 &mvp, ClipSpaceVertices &out) {
+        unsigned int size = vts.size();
+        out.resize(size);
+        unsigned int i = 0;
+
+#ifdef SRL_USE_SSE
+        // mvp[c][r] broadcast to all lanes, each lane transforms a different vertex
+        __m128 m[4][4];
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                m[c][r] = _mm_set1_ps(mvp[c][r]);
+
+        for (; i + 4 <= size; i += 4) {
+            // load four positions and transpose them, so that px holds the x of the four vertices, etc.
+            __m128 px = _mm_loadu_ps(&vts[i].pos[0]);
+            __m128 py = _mm_loadu_ps(&vts[i + 1].pos[0]);
+            __m128 pz = _mm_loadu_ps(&vts[i + 2].pos[0]);
+            __m128 pw = _mm_loadu_ps(&vts[i + 3].pos[0]);
+            _MM_TRANSPOSE4_PS(px, py, pz, pw);
+
+            __m128 clip[4];
+            for (int r = 0; r < 4; r++)
+                clip[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][r], px), _mm_mul_ps(m[1][r], py)),
+                                     _mm_add_ps(_mm_mul_ps(m[2][r], pz), _mm_mul_ps(m[3][r], pw)));
+            _mm_storeu_ps(&out.x[i], clip[0]);
+            _mm_storeu_ps(&out.y[i], clip[1]);
+            _mm_storeu_ps(&out.z[i], clip[2]);
+            _mm_storeu_ps(&out.w[i], clip[3]);
+
+            // one bit per lane for each plane
+            __m128 negW = _mm_sub_ps(_mm_setzero_ps(), clip[3]);
+            int outside[6] = {
+                _mm_movemask_ps(_mm_cmplt_ps(clip[0], negW)), _mm_movemask_ps(_mm_cmpgt_ps(clip[0], clip[3])),
+                _mm_movemask_ps(_mm_cmplt_ps(clip[1], negW)), _mm_movemask_ps(_mm_cmpgt_ps(clip[1], clip[3])),
+                _mm_movemask_ps(_mm_cmplt_ps(clip[2], negW)), _mm_movemask_ps(_mm_cmpgt_ps(clip[2], clip[3]))
+            };
+            for (int lane = 0; lane < 4; lane++) {
+                uint8_t code = 0;
+                for (int plane = 0; plane < 6; plane++)
+                    code |= ((outside[plane] >> lane) & 1) << plane;
+                out.outcode[i + lane] = code;
+            }
+        }
+#endif
+
+        // remaining vertices (or all of them without SSE)
+        for (; i < size; i++) {
+            glm::vec4 pos = mvp * vts[i].pos;
+            out.x[i] = pos.x; out.y[i] = pos.y; out.z[i] = pos.z; out.w[i] = pos.w;
+            out.outcode[i] = computeOutCode(pos.x, pos.y, pos.z, pos.w);
+        }
+    }
+
+    // same as transformVertices, with the clip space positions given by position(vertex) (e.g. the position
+    // of a shader), computed one vertex at a time
+    template<class Position>
+    inline void shadePositions(const std::vector<vertex> &vts, Position &&position, ClipSpaceVertices &out) {
+        unsigned int size = vts.size();
+        out.resize(size);
+        for (unsigned int i = 0; i < size; i++) {
+            glm::vec4 pos = position(vts[i]);
+            out.x[i] = pos.x; out.y[i] = pos.y; out.z[i] = pos.z; out.w[i] = pos.w;
+            out.outcode[i] = computeOutCode(pos.x, pos.y, pos.z, pos.w);
+        }
+    }
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLCLIPSPACE_H
@@ -0,0 +1,227 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLDEPTHPYRAMID_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLDEPTHPYRAMID_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "srl_frame_buffer.h"
+
+namespace srl {
+
+    // hierarchical z-buffer: the min and max depth of blocks of pixels of a depth buffer.
+    // Level 0 has one cell per BLOCK_SIZE x BLOCK_SIZE pixels, and each following level has one cell
+    // per 2x2 cells of the previous level, up to a single cell covering the whole buffer.
+    // Since the depth test only lets closer fragments through, anything whose nearest depth is
+    // not closer than the max depth of the area it covers can be rejected without rasterizing it.
+    // A max depth that is out of date (too far) only makes the rejection less effective, never wrong.
+    class DepthPyramid {
+    public:
+        static const int BLOCK_SIZE = 8;
+
+        // make sure the pyramid matches db: nothing to do if db did not change since the last update,
+        // reset to the clear value if db was cleared, rebuild from the buffer otherwise
+        void sync(const FrameBuffer <float> &db) {
+            bool sameBuffer = (m_db == &db && m_width == db.width() && m_height == db.height());
+            if (sameBuffer && m_revision == db.revision())
+                return;
+
+            if (!sameBuffer)
+                allocate(db);
+
+            if (db.revision() == db.clearRevision()) {
+                for (auto &level : m_levels) {
+                    std::fill(level.minDepth.begin(), level.minDepth.end(), db.clearValue());
+                    std::fill(level.maxDepth.begin(), level.maxDepth.end(), db.clearValue());
+                }
+                for (auto &dirty : m_dirty)
+                    std::fill(dirty.begin(), dirty.end(), 0);
+                for (auto &list : m_dirtyList)
+                    list.clear();
+            }
+            else {
+                invalidate(0, 0, m_width - 1, m_height - 1);
+                update(db);
+            }
+            m_revision = db.revision();
+        }
+
+        // mark the level 0 blocks overlapping the rectangle [x0, x1] x [y0, y1] (in pixels) as modified
+        void invalidate(int x0, int y0, int x1, int y1) {
+            invalidateCells(0, x0 / BLOCK_SIZE, y0 / BLOCK_SIZE, x1 / BLOCK_SIZE, y1 / BLOCK_SIZE);
+        }
+
+        // set the min and max depth of a level 0 block, e.g. computed from a tile that was just rasterized.
+        // Different threads can set different blocks, but the levels above are only updated by
+        // a later call to invalidateParents and update
+        inline void setBlock(int bx, int by, float minDepth, float maxDepth) {
+            Level &level = m_levels[0];
+            level.minDepth[by * level.width + bx] = minDepth;
+            level.maxDepth[by * level.width + bx] = maxDepth;
+        }
+
+        // mark the cells above the level 0 blocks overlapping the rectangle [x0, x1] x [y0, y1] as modified
+        void invalidateParents(int x0, int y0, int x1, int y1) {
+            if (m_levels.size() > 1)
+                invalidateCells(1, x0 / (BLOCK_SIZE * 2), y0 / (BLOCK_SIZE * 2), x1 / (BLOCK_SIZE * 2), y1 / (BLOCK_SIZE * 2));
+        }
+
+        // recompute the modified cells, level 0 from the depth buffer and the other levels from the level below,
+        // and record the revision of db
+        void update(const FrameBuffer <float> &db) {
+            for (int l = 0, count = m_levels.size(); l < count; l++) {
+                Level &level = m_levels[l];
+                for (unsigned int cell : m_dirtyList[l]) {
+                    int cx = cell % level.width, cy = cell / level.width;
+                    float minDepth, maxDepth;
+                    if (l == 0)
+                        blockRange(db, cx, cy, minDepth, maxDepth);
+                    else
+                        childrenRange(l, cx, cy, minDepth, maxDepth);
+                    level.minDepth[cell] = minDepth;
+                    level.maxDepth[cell] = maxDepth;
+                    m_dirty[l][cell] = 0;
+                    if (l + 1 < count)
+                        invalidateCells(l + 1, cx / 2, cy / 2, cx / 2, cy / 2);
+                }
+                m_dirtyList[l].clear();
+            }
+            m_revision = db.revision();
+        }
+
+        // farthest depth in the rectangle [x0, x1] x [y0, y1], in pixels. The rectangle must be inside the buffer
+        float maxDepth(int x0, int y0, int x1, int y1) const {
+            float maxDepth = -std::numeric_limits<float>::max();
+            forCells(x0, y0, x1, y1, [&](const Level &level, int cell) {
+                maxDepth = std::max(maxDepth, level.maxDepth[cell]);
+            });
+            return maxDepth;
+        }
+
+        // nearest depth in the rectangle [x0, x1] x [y0, y1], in pixels. The rectangle must be inside the buffer
+        float minDepth(int x0, int y0, int x1, int y1) const {
+            float minDepth = std::numeric_limits<float>::max();
+            forCells(x0, y0, x1, y1, [&](const Level &level, int cell) {
+                minDepth = std::min(minDepth, level.minDepth[cell]);
+            });
+            return minDepth;
+        }
+
+        // true if nothing with depth >= nearestDepth can pass the depth test in the rectangle [x0, x1] x [y0, y1]
+        inline bool occluded(int x0, int y0, int x1, int y1, float nearestDepth) const {
+            return nearestDepth >= maxDepth(x0, y0, x1, y1);
+        }
+
+        // max depth of the level 0 blocks, row by row, blocksX() blocks per row
+        inline const float *blockMaxDepths() const { return m_levels[0].maxDepth.data(); }
+        inline int blocksX() const { return m_levels[0].width; }
+        inline int blocksY() const { return m_levels[0].height; }
+
+    private:
+
+        struct Level {
+            int width = 0;
+            int height = 0;
+            std::vector<float> minDepth;
+            std::vector<float> maxDepth;
+        };
+
+        void allocate(const FrameBuffer <float> &db) {
+            m_db = &db;
+            m_width = db.width();
+            m_height = db.height();
+            m_levels.clear();
+            int width = (m_width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            int height = (m_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            while (true) {
+                Level level;
+                level.width = width;
+                level.height = height;
+                level.minDepth.resize(width * height);
+                level.maxDepth.resize(width * height);
+                m_levels.push_back(level);
+                if (width == 1 && height == 1)
+                    break;
+                width = (width + 1) / 2;
+                height = (height + 1) / 2;
+            }
+            m_dirty.assign(m_levels.size(), std::vector<unsigned char>());
+            m_dirtyList.assign(m_levels.size(), std::vector<unsigned int>());
+            for (unsigned int l = 0; l < m_levels.size(); l++)
+                m_dirty[l].assign(m_levels[l].width * m_levels[l].height, 0);
+        }
+
+        void invalidateCells(int l, int cx0, int cy0, int cx1, int cy1) {
+            const Level &level = m_levels[l];
+            cx0 = std::max(cx0, 0); cy0 = std::max(cy0, 0);
+            cx1 = std::min(cx1, level.width - 1); cy1 = std::min(cy1, level.height - 1);
+            for (int cy = cy0; cy <= cy1; cy++)
+                for (int cx = cx0; cx <= cx1; cx++) {
+                    unsigned int cell = cy * level.width + cx;
+                    if (!m_dirty[l][cell]) {
+                        m_dirty[l][cell] = 1;
+                        m_dirtyList[l].push_back(cell);
+                    }
+                }
+        }
+
+        // min and max depth of level 0 block (bx, by), read from the depth buffer
+        void blockRange(const FrameBuffer <float> &db, int bx, int by, float &minDepth, float &maxDepth) const {
+            int x0 = bx * BLOCK_SIZE, x1 = std::min(x0 + BLOCK_SIZE, (int) m_width);
+            int y0 = by * BLOCK_SIZE, y1 = std::min(y0 + BLOCK_SIZE, (int) m_height);
+            db.resolveRect(x0, y0, x1 - 1, y1 - 1);
+            const float *depths = db.data();
+            minDepth = maxDepth = depths[db.indexAt(x0, y0)];
+            // the block is read in the layout of db, the min and max do not depend on the order
+            db.withAddressing([&](const auto &addressing) {
+                for (int y = y0; y < y1; y++)
+                    for (int x = x0; x < x1; x++) {
+                        float depth = depths[addressing.index(x, y)];
+                        minDepth = std::min(minDepth, depth);
+                        maxDepth = std::max(maxDepth, depth);
+                    }
+            });
+        }
+
+        // min and max depth of cell (cx, cy) of level l, from its children in level l-1
+        void childrenRange(int l, int cx, int cy, float &minDepth, float &maxDepth) const {
+            const Level &below = m_levels[l - 1];
+            int x0 = cx * 2, x1 = std::min(x0 + 2, below.width);
+            int y0 = cy * 2, y1 = std::min(y0 + 2, below.height);
+            minDepth = below.minDepth[y0 * below.width + x0];
+            maxDepth = below.maxDepth[y0 * below.width + x0];
+            for (int y = y0; y < y1; y++)
+                for (int x = x0; x < x1; x++) {
+                    minDepth = std::min(minDepth, below.minDepth[y * below.width + x]);
+                    maxDepth = std::max(maxDepth, below.maxDepth[y * below.width + x]);
+                }
+        }
+
+        // visit the (at most 2x2) cells of the finest level where the rectangle covers at most two cells per axis
+        template<class Visit>
+        void forCells(int x0, int y0, int x1, int y1, Visit &&visit) const {
+            int l = 0, count = m_levels.size();
+            int cellSize = BLOCK_SIZE;
+            while (l + 1 < count && (x1 / cellSize - x0 / cellSize > 1 || y1 / cellSize - y0 / cellSize > 1)) {
+                l++;
+                cellSize *= 2;
+            }
+            const Level &level = m_levels[l];
+            for (int cy = y0 / cellSize; cy <= y1 / cellSize; cy++)
+                for (int cx = x0 / cellSize; cx <= x1 / cellSize; cx++)
+                    visit(level, cy * level.width + cx);
+        }
+
+        const FrameBuffer <float> *m_db = nullptr;
+        unsigned int m_width = 0;
+        unsigned int m_height = 0;
+        unsigned int m_revision = 0;
+
+        std::vector<Level> m_levels;
+        // modified cells of each level, as flags and as a list
+        std::vector<std::vector<unsigned char> > m_dirty;
+        std::vector<std::vector<unsigned int> > m_dirtyList;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLDEPTHPYRAMID_H
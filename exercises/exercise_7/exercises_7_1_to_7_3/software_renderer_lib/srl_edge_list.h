@@ -0,0 +1,155 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLEDGELIST_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLEDGELIST_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include "srl_types.h"
+
+namespace srl {
+
+    // an edge between vertices v1 and v2 of a vertex stream (see VertexStream in srl_renderer.h)
+    struct Edge {
+        unsigned int v1, v2;
+    };
+
+    // the edges of the triangles of a mesh, each edge shared by several triangles only once, so that a wireframe
+    // draws each of them once. With an index buffer, two edges are the same if they join the same pair of vertex
+    // indices, without it, if they join the same pair of positions. Each edge keeps the vertices and direction of
+    // its first triangle.
+    // The edges of the last few meshes are cached, a mesh is identified by its vector and the edges are only
+    // computed again if the indices (or the positions, without indices) changed
+    class EdgeList {
+    public:
+        static const unsigned int CACHE_SIZE = 8;
+
+        // the unique edges of the triangles vts[indices[0]], vts[indices[1]], vts[indices[2]], ..., or vts[0],
+        // vts[1], vts[2], ... if indices is nullptr. Valid until the next call
+        const std::vector<Edge> &edges(const std::vector<vertex> &vts, const std::vector<unsigned int> *indices) {
+            const void *mesh = indices ? (const void *) indices : (const void *) &vts;
+            Entry *entry = find(mesh);
+            m_time++;
+
+            // the cached edges are only valid if the mesh is still the same
+            if (entry->mesh == mesh && (indices ? sameIndices(*entry, *indices) : samePositions(*entry, vts))) {
+                entry->lastUsed = m_time;
+                return entry->edges;
+            }
+
+            entry->mesh = mesh;
+            entry->lastUsed = m_time;
+            entry->indices.clear();
+            entry->positions.clear();
+            if (indices) {
+                entry->indices = *indices;
+                buildIndexed(*indices, entry->edges);
+            }
+            else {
+                entry->positions.reserve(vts.size());
+                for (const vertex &v : vts)
+                    entry->positions.push_back(glm::vec3(v.pos));
+                buildUnindexed(entry->positions, entry->edges);
+            }
+            return entry->edges;
+        }
+
+    private:
+        struct Entry {
+            const void *mesh = nullptr;
+            uint64_t lastUsed = 0;
+            // what the edges were computed from
+            std::vector<unsigned int> indices;
+            std::vector<glm::vec3> positions;
+            std::vector<Edge> edges;
+        };
+
+        // the entry of mesh, or the least recently used one
+        Entry *find(const void *mesh) {
+            Entry *oldest = nullptr;
+            for (Entry &entry : m_cache) {
+                if (entry.mesh == mesh)
+                    return &entry;
+                if (!oldest || entry.lastUsed < oldest->lastUsed)
+                    oldest = &entry;
+            }
+            if (m_cache.size() < CACHE_SIZE) {
+                m_cache.emplace_back();
+                return &m_cache.back();
+            }
+            return oldest;
+        }
+
+        static bool sameIndices(const Entry &entry, const std::vector<unsigned int> &indices) {
+            return entry.positions.empty() && entry.indices.size() == indices.size() &&
+                   std::equal(indices.begin(), indices.end(), entry.indices.begin());
+        }
+
+        static bool samePositions(const Entry &entry, const std::vector<vertex> &vts) {
+            if (!entry.indices.empty() || entry.positions.size() != vts.size())
+                return false;
+            for (unsigned int i = 0, size = vts.size(); i < size; i++)
+                if (std::memcmp(&entry.positions[i], &vts[i].pos, sizeof(glm::vec3)) != 0)
+                    return false;
+            return true;
+        }
+
+        // key of the edge between a and b, the same in both directions
+        static inline uint64_t edgeKey(unsigned int a, unsigned int b) {
+            return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+        }
+
+        // the edges of the triangles of a stream of count vertices, ids(i) is the id of vertex i of the stream.
+        // Vertices with the same id are the same vertex
+        template<class Ids>
+        static void build(unsigned int count, const Ids &ids, std::vector<Edge> &edges) {
+            unsigned int triangles = count / 3;
+            edges.clear();
+            edges.reserve(triangles * 3 / 2 + 3);
+            std::unordered_set<uint64_t> seen;
+            seen.reserve(triangles * 3);
+            for (unsigned int t = 0; t < triangles; t++) {
+                unsigned int i = t * 3;
+                const unsigned int corners[3] = {i, i + 1, i + 2};
+                for (int e = 0; e < 3; e++) {
+                    unsigned int v1 = corners[e], v2 = corners[(e + 1) % 3];
+                    if (seen.insert(edgeKey(ids(v1), ids(v2))).second)
+                        edges.push_back(Edge {v1, v2});
+                }
+            }
+        }
+
+        static void buildIndexed(const std::vector<unsigned int> &indices, std::vector<Edge> &edges) {
+            build(indices.size(), [&](unsigned int i) { return indices[i]; }, edges);
+        }
+
+        // vertices with the same position get the same id
+        static void buildUnindexed(const std::vector<glm::vec3> &positions, std::vector<Edge> &edges) {
+            struct PositionHash {
+                std::size_t operator()(const glm::vec3 &p) const {
+                    uint32_t bits[3];
+                    std::memcpy(bits, &p, sizeof(bits));
+                    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+                }
+            };
+            // the same bits, as in the hash (so 0 and -0 are different positions)
+            struct PositionEqual {
+                bool operator()(const glm::vec3 &a, const glm::vec3 &b) const { return std::memcmp(&a, &b, sizeof(a)) == 0; }
+            };
+            std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> firstVertex;
+            firstVertex.reserve(positions.size());
+            std::vector<unsigned int> ids(positions.size());
+            for (unsigned int i = 0, size = positions.size(); i < size; i++)
+                ids[i] = firstVertex.emplace(positions[i], i).first->second;
+            build(positions.size(), [&](unsigned int i) { return ids[i]; }, edges);
+        }
+
+        std::vector<Entry> m_cache;
+        uint64_t m_time = 0;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLEDGELIST_H
@@ -0,0 +1,172 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMEARENA_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMEARENA_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace srl {
+
+    class FrameArena;
+
+    // std allocator that takes memory from a FrameArena. Memory is never given back one allocation at a time,
+    // the whole arena is reset at the end of the frame. A default constructed allocator uses the heap
+    template<class T>
+    struct ArenaAllocator {
+        typedef T value_type;
+        // containers take the allocator (and the arena) of the container they are assigned from
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        FrameArena *arena = nullptr;
+        // frame in which this allocator was created, memory from an older frame is no longer valid
+        unsigned int generation = 0;
+
+        ArenaAllocator() = default;
+        ArenaAllocator(FrameArena *arena, unsigned int generation) : arena(arena), generation(generation) {}
+        template<class U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena), generation(other.generation) {}
+
+        T *allocate(std::size_t n);
+        void deallocate(T *p, std::size_t) {
+            if (!arena)
+                ::operator delete(p);
+        }
+
+        template<class U>
+        bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena && generation == other.generation; }
+        template<class U>
+        bool operator!=(const ArenaAllocator<U> &other) const { return !(*this == other); }
+    };
+
+    // vector of pipeline scratch data allocated in a FrameArena
+    template<class T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+    // bump allocator for the data that only lives during a frame (vertices, primitives, fragments, ...).
+    // Allocating is just moving a pointer forward and nothing is freed until endFrame, which makes
+    // the whole arena available again. When a frame needs more than one chunk of memory, the chunks are
+    // merged into a single one at the end of the frame, so after a few frames the arena stops allocating
+    class FrameArena {
+    public:
+
+        explicit FrameArena(std::size_t chunkSize = 1 << 16) : m_chunkSize(chunkSize) {}
+
+        ~FrameArena() {
+            for (auto &chunk : m_chunks)
+                ::operator delete(chunk.data);
+        }
+
+        FrameArena(const FrameArena &) = delete;
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        // start a frame, anything allocated before is released
+        void beginFrame() {
+            reset();
+            m_inFrame = true;
+        }
+
+        // end a frame and release everything allocated during it
+        void endFrame() {
+            reset();
+            m_inFrame = false;
+        }
+
+        inline bool inFrame() const { return m_inFrame; }
+
+        // changes every time the arena is reset
+        inline unsigned int generation() const { return m_generation; }
+
+        // bytes allocated in the current frame, the most bytes ever allocated in a frame, and the bytes reserved
+        inline std::size_t used() const { return m_used; }
+        inline std::size_t highWaterMark() const { return m_highWaterMark; }
+        std::size_t capacity() const {
+            std::size_t capacity = 0;
+            for (auto &chunk : m_chunks)
+                capacity += chunk.size;
+            return capacity;
+        }
+
+        void *allocate(std::size_t bytes, std::size_t alignment) {
+            while (true) {
+                if (m_current < m_chunks.size()) {
+                    Chunk &chunk = m_chunks[m_current];
+                    std::size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+                    if (offset + bytes <= chunk.size) {
+                        m_used += offset + bytes - m_offset;
+                        m_highWaterMark = std::max(m_highWaterMark, m_used);
+                        m_offset = offset + bytes;
+                        return chunk.data + offset;
+                    }
+                    // what is left of this chunk is wasted until the end of the frame
+                    m_used += chunk.size - m_offset;
+                    m_current++;
+                    m_offset = 0;
+                }
+                else {
+                    // new memory is aligned to alignof(std::max_align_t)
+                    std::size_t size = std::max(m_chunkSize, bytes + alignment);
+                    m_chunks.push_back(Chunk {static_cast<char *>(::operator new(size)), size});
+                }
+            }
+        }
+
+        // make v an empty vector allocated in this arena. If v already is, its memory is kept
+        template<class T>
+        void prepare(ArenaVector<T> &v) {
+            // the elements of an old vector live in memory that was released, so they must not need destruction
+            static_assert(std::is_trivially_destructible<T>::value, "arena vectors only hold trivially destructible types");
+            if (v.get_allocator() != ArenaAllocator<T>(this, m_generation))
+                v = ArenaVector<T>(ArenaAllocator<T>(this, m_generation));
+            else
+                v.clear();
+        }
+
+    private:
+
+        struct Chunk {
+            char *data;
+            std::size_t size;
+        };
+
+        void reset() {
+            // merge the chunks, the next frame will likely need as much memory as this one
+            if (m_chunks.size() > 1) {
+                std::size_t size = capacity();
+                for (auto &chunk : m_chunks)
+                    ::operator delete(chunk.data);
+                m_chunks.clear();
+                m_chunks.push_back(Chunk {static_cast<char *>(::operator new(size)), size});
+            }
+            m_current = 0;
+            m_offset = 0;
+            m_used = 0;
+            m_generation++;
+        }
+
+        std::size_t m_chunkSize;
+        std::vector<Chunk> m_chunks;
+        // chunk we are allocating from, and the first free byte in it
+        std::size_t m_current = 0;
+        std::size_t m_offset = 0;
+
+        std::size_t m_used = 0;
+        std::size_t m_highWaterMark = 0;
+        unsigned int m_generation = 1;
+        bool m_inFrame = false;
+    };
+
+    template<class T>
+    T *ArenaAllocator<T>::allocate(std::size_t n) {
+        if (!arena)
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMEARENA_H
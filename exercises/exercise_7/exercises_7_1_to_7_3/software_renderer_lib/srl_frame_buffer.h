@@ -6,32 +6,119 @@
 #define GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMEBUFFER_H
 
 #include <vector>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
 
 namespace srl {
 
+    // order in which the pixels of a frame buffer are stored in memory. Linear is row after row, the others store
+    // the pixels in square tiles, so that pixels that are close in the image (e.g. the pixels of a small triangle,
+    // or the same column of consecutive rows) are also close in memory and share cache lines
+    enum class BufferLayout {
+        Linear,
+        Tiled4x4,   // 4x4 tiles (a 64 byte cache line of 32 bit pixels), rows of 4 pixels inside of a tile
+        Tiled8x8,   // 8x8 tiles, rows of 8 pixels inside of a tile
+        Morton      // 32x32 tiles, pixels in z-order (morton order) inside of a tile
+    };
+
+    // addressing of the layouts, index(x, y) is the position of pixel (x, y) in memory. All of them store
+    // TILE_SIZE x TILE_SIZE tiles one after the other, tilesX tiles per row, so each row of tiles is contiguous
+    // (the linear layout has 1x1 tiles). The buffer is padded to a whole number of tiles
+    struct LinearAddressing {
+        static const unsigned int TILE_SIZE = 1;
+        unsigned int tilesX;
+
+        inline unsigned int index(unsigned int x, unsigned int y) const { return y * tilesX + x; }
+    };
+
+    template<unsigned int N>
+    struct TiledAddressing {
+        static const unsigned int TILE_SIZE = N;
+        unsigned int tilesX;
+
+        inline unsigned int index(unsigned int x, unsigned int y) const {
+            return ((y / N) * tilesX + x / N) * (N * N) + (y % N) * N + x % N;
+        }
+    };
+
+    struct MortonAddressing {
+        static const unsigned int TILE_SIZE = 32;
+        unsigned int tilesX;
+
+        // spread the lower 16 bits of v, bit i goes to bit 2i
+        static inline unsigned int spread(unsigned int v) {
+            v = (v | (v << 8)) & 0x00FF00FFu;
+            v = (v | (v << 4)) & 0x0F0F0F0Fu;
+            v = (v | (v << 2)) & 0x33333333u;
+            v = (v | (v << 1)) & 0x55555555u;
+            return v;
+        }
 
+        inline unsigned int index(unsigned int x, unsigned int y) const {
+            return (((y >> 5) * tilesX + (x >> 5)) << 10) | spread(x & 31u) | (spread(y & 31u) << 1);
+        }
+    };
+
+
+    // a frame buffer can be cleared eagerly (clearBuffer) or lazily (fastClear). A fast clear only marks the
+    // CLEAR_TILE_SIZE x CLEAR_TILE_SIZE tiles of the buffer as cleared, and each tile is filled with the clear value
+    // the first time it is accessed (resolved). Tiles nothing is drawn to are written once, when the buffer is read back.
+    // buffer() resolves the whole buffer, so it is always safe to read. Code that accesses the memory directly
+    // with data() or operator[] must first resolve what it touches, with resolveAt or resolveRect.
+    // The pixels are stored in the layout given to the constructor, indexAt gives their position in memory
+    // (inner loops get the addressing once with withAddressing). linear() is the image in row order
     template<class T>
     class FrameBuffer {
     public:
 
-        FrameBuffer(unsigned int width, unsigned int height);
+        static const unsigned int CLEAR_TILE_SIZE = 32;
+
+        FrameBuffer(unsigned int width, unsigned int height, BufferLayout layout = BufferLayout::Linear);
         FrameBuffer(const FrameBuffer<T> &fb);
         ~FrameBuffer();
 
         inline unsigned int width() const { return m_width; }
         inline unsigned int height() const { return m_height; }
+        // number of elements in memory, including the padding of the tiled layouts
         inline unsigned int size() const { return m_size; }
-        // we need to be able to get a pointer to the buffer to set the render texture
-        inline T *buffer() const { return m_buffer; }
-		
+        inline BufferLayout layout() const { return m_layout; }
+        // we need to be able to get a pointer to the buffer to set the render texture (any pending clear is resolved).
+        // The pixels are in the order of layout(), use linear() to get them in row order
+        inline T *buffer() const { resolve(); return m_buffer; }
+        // the memory of the buffer as it is, the tiles that are still pending a clear hold old values
+        inline T *data() const { return m_buffer; }
+
+        // the image in row order, to upload it as a texture or write it to a file. This is buffer() for the
+        // linear layout, the other layouts are copied to a scratch buffer that is valid until the next call
+        const T *linear() const;
+        // copy the image in row order to dst, which has room for width() x height() elements
+        void copyToLinear(T *dst) const;
+
+        // call f(addressing) with the addressing of the layout of this buffer, so that the
+        // code inside of f computes the position of pixels without testing the layout again
+        template<class F>
+        void withAddressing(F &&f) const {
+            switch (m_layout) {
+                case BufferLayout::Tiled4x4: f(TiledAddressing<4> {tilesPerRow(4)}); break;
+                case BufferLayout::Tiled8x8: f(TiledAddressing<8> {tilesPerRow(8)}); break;
+                case BufferLayout::Morton: f(MortonAddressing {tilesPerRow(MortonAddressing::TILE_SIZE)}); break;
+                default: f(LinearAddressing {m_width}); break;
+            }
+        }
+
 		inline unsigned int indexAt(unsigned int u, unsigned int v) const {
-			return (v >= m_height ? m_height - 1 : v) * m_width + (u >= m_width ? m_width - 1 : u);
+            u = u >= m_width ? m_width - 1 : u;
+            v = v >= m_height ? m_height - 1 : v;
+            unsigned int index = 0;
+            withAddressing([&](const auto &addressing) { index = addressing.index(u, v); });
+            return index;
 		}
 
 		inline unsigned int indexAtNorm(float uNorm, float vNorm) const {
 			unsigned int u = (uNorm * m_width);
 			unsigned int v = (vNorm * m_height);
-			return (v >= m_height ? m_height - 1 : v) * m_width + (u >= m_width ? m_width - 1 : u);
+			return indexAt(u, v);
 		}
 
         inline T &operator[](unsigned int index) { return m_buffer[index]; }
@@ -42,24 +129,101 @@ namespace srl {
         void clearBuffer(const T &value);
         // set frame buffer to zero
         void clearBuffer();
+        // set frame buffer to value, lazily, one tile at a time when the tiles are accessed
+        void fastClear(const T &value);
+
+        // fill the tiles pending a clear with the clear value, in the whole buffer or in the
+        // rectangle [x0, x1] x [y0, y1] (in pixels, inside the buffer)
+        void resolve() const;
+        void resolveRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const;
+        // resolve the tile of pixel (x, y), call before accessing the pixel with operator[]
+        inline void resolveAt(unsigned int x, unsigned int y) const {
+            if (m_pendingTiles) {
+                unsigned int tile = (y / CLEAR_TILE_SIZE) * m_tilesX + x / CLEAR_TILE_SIZE;
+                if (m_tilePending[tile])
+                    resolveTile(tile);
+            }
+        }
+
+        // copy the rectangle [x0, x1] x [y0, y1] to dst (with rows of dstStride elements). The pixels of pending tiles
+        // are set to the clear value without resolving them, so that a tile that is about to be overwritten
+        // is not written twice
+        void loadRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, T *dst, unsigned int dstStride) const;
+        // copy src (with rows of srcStride elements) to the rectangle [x0, x1] x [y0, y1]. Pending tiles fully inside
+        // of the rectangle are simply overwritten, the others are resolved first.
+        // Different threads can load and store rectangles that do not share any tile
+        void storeRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, const T *src, unsigned int srcStride);
+
+        // the revision changes every time the buffer is cleared or marked as modified, this is used
+        // by data derived from the buffer (e.g. a depth pyramid) to find out if it is still up to date
+        inline unsigned int revision() const { return m_revision; }
+        // revision of the last clear and the value used, the buffer is uniform if revision() == clearRevision()
+        inline unsigned int clearRevision() const { return m_clearRevision; }
+        inline const T &clearValue() const { return m_clearValue; }
+        // call after writing to the buffer, returns the new revision
+        inline unsigned int markModified() { return ++m_revision; }
 
     private:
 
         unsigned int m_width;
         unsigned int m_height;
         unsigned int m_size;
+        BufferLayout m_layout;
 
         T *m_buffer;
+        // row order copy of the image returned by linear()
+        mutable std::vector<T> m_linear;
+
+        inline unsigned int tilesPerRow(unsigned int tileSize) const { return (m_width + tileSize - 1) / tileSize; }
+        // number of elements in memory, padded to a whole number of tiles of the layout
+        unsigned int storageSize() const;
+
+        // fill count elements starting at p with the clear value
+        void fillSpan(T *p, unsigned int count) const;
+        // fill [x0, x1] x [y0, y1] with the clear value, the rectangle starts at a clear tile
+        // and ends at the end of a clear tile or of the buffer, so it covers whole tiles of the layout
+        template<class Addressing>
+        void fillRect(const Addressing &addressing, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const;
+
+        void copyToLinear(const LinearAddressing &addressing, T *dst) const;
+        template<unsigned int N>
+        void copyToLinear(const TiledAddressing<N> &addressing, T *dst) const;
+        void copyToLinear(const MortonAddressing &addressing, T *dst) const;
+
+        // fast clear, one flag per tile and the number of tiles pending a clear
+        void allocateTiles();
+        void resolveTile(unsigned int tile) const;
+        // range of the tiles overlapping [x0, x1] x [y0, y1]
+        void tileRange(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+                       unsigned int &tx0, unsigned int &ty0, unsigned int &tx1, unsigned int &ty1) const {
+            tx0 = x0 / CLEAR_TILE_SIZE; ty0 = y0 / CLEAR_TILE_SIZE;
+            tx1 = x1 / CLEAR_TILE_SIZE; ty1 = y1 / CLEAR_TILE_SIZE;
+        }
+        unsigned int m_tilesX = 0;
+        unsigned int m_tilesY = 0;
+        mutable std::vector<unsigned char> m_tilePending;
+        mutable std::atomic<unsigned int> m_pendingTiles {0};
+        // a row of a tile set to the clear value, filling is copying it (and then what was already filled)
+        T m_clearRow[CLEAR_TILE_SIZE];
+
+        unsigned int m_revision = 1;
+        unsigned int m_clearRevision = 0;
+        T m_clearValue = T();
 
     };
 
+    template<class T>
+    const unsigned int FrameBuffer<T>::CLEAR_TILE_SIZE;
+
     // constructor
     template<class T>
-    FrameBuffer<T>::FrameBuffer(unsigned int width, unsigned int height) {
+    FrameBuffer<T>::FrameBuffer(unsigned int width, unsigned int height, BufferLayout layout) {
         m_width = width;
         m_height = height;
-        m_size = m_width * m_height;
+        m_layout = layout;
+        m_size = storageSize();
         m_buffer = new T[m_size]; // memory allocation in C++
+        allocateTiles();
     }
 
     // copy constructor
@@ -67,8 +231,10 @@ namespace srl {
     FrameBuffer<T>::FrameBuffer(const FrameBuffer<T> &fb) {
         m_width = fb.m_width;
         m_height = fb.m_height;
+        m_layout = fb.m_layout;
         m_size = fb.m_size;
         m_buffer = new T[m_size]; // memory allocation in C++
+        allocateTiles();
         // make a copy of the buffer into the new object
         memcpy(m_buffer, fb.buffer(), sizeof(T) * m_size);
     }
@@ -78,10 +244,13 @@ namespace srl {
         delete[] m_buffer;
         m_width = fb.m_width;
         m_height = fb.m_height;
-        m_size = fb.my_size;
+        m_layout = fb.m_layout;
+        m_size = fb.m_size;
         m_buffer = new T[m_size]; // memory allocation in C++
+        allocateTiles();
         // make a copy of the buffer into this object
         memcpy(m_buffer, fb.buffer(), sizeof(T) * m_size);
+        markModified();
         return *this;
     }
 
@@ -91,19 +260,221 @@ namespace srl {
         delete[] m_buffer;
     }
 
+    template<class T>
+    const T *FrameBuffer<T>::linear() const {
+        if (m_layout == BufferLayout::Linear)
+            return buffer();
+        m_linear.resize(m_width * m_height);
+        copyToLinear(m_linear.data());
+        return m_linear.data();
+    }
+
+    template<class T>
+    void FrameBuffer<T>::copyToLinear(T *dst) const {
+        resolve();
+        withAddressing([&](const auto &addressing) { copyToLinear(addressing, dst); });
+    }
+
+    template<class T>
+    void FrameBuffer<T>::copyToLinear(const LinearAddressing &, T *dst) const {
+        memcpy(dst, m_buffer, sizeof(T) * m_width * m_height);
+    }
+
+    // each row of a tile is contiguous, copy it in one go
+    template<class T>
+    template<unsigned int N>
+    void FrameBuffer<T>::copyToLinear(const TiledAddressing<N> &addressing, T *dst) const {
+        for (unsigned int y = 0; y < m_height; y++)
+            for (unsigned int x = 0; x < m_width; x += N)
+                memcpy(dst + y * m_width + x, m_buffer + addressing.index(x, y), sizeof(T) * std::min(N, m_width - x));
+    }
+
+    // the offsets of the columns and rows inside of a tile are computed once, a pixel is then a single addition
+    template<class T>
+    void FrameBuffer<T>::copyToLinear(const MortonAddressing &addressing, T *dst) const {
+        const unsigned int n = MortonAddressing::TILE_SIZE;
+        unsigned int offsetX[n], offsetY[n];
+        for (unsigned int i = 0; i < n; i++) {
+            offsetX[i] = MortonAddressing::spread(i);
+            offsetY[i] = MortonAddressing::spread(i) << 1;
+        }
+        for (unsigned int y = 0; y < m_height; y++) {
+            T *row = dst + y * m_width;
+            for (unsigned int x0 = 0; x0 < m_width; x0 += n) {
+                const T *tileRow = m_buffer + addressing.index(x0, y - y % n) + offsetY[y % n];
+                for (unsigned int x = 0, count = std::min(n, m_width - x0); x < count; x++)
+                    row[x0 + x] = tileRow[offsetX[x]];
+            }
+        }
+    }
+
     // set frame buffer value
     template<class T>
     void FrameBuffer<T>::clearBuffer(const T &value) {
-        for (unsigned int i = 0; i < m_size; i++)
-            m_buffer[i] = value;
+        // all bytes of value are the same (e.g. 0), memset the whole buffer
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+        if (std::all_of(bytes, bytes + sizeof(T), [&](unsigned char byte) { return byte == bytes[0]; }))
+            memset(m_buffer, bytes[0], sizeof(T) * m_size);
+        // otherwise fill the start of the buffer and copy it to the rest, memcpy is as fast as a fill gets.
+        // The padding is cleared too, the layout does not matter
+        else {
+            std::fill(m_clearRow, m_clearRow + CLEAR_TILE_SIZE, value);
+            fillSpan(m_buffer, m_size);
+        }
+        std::fill(m_tilePending.begin(), m_tilePending.end(), 0);
+        m_pendingTiles = 0;
+        m_clearValue = value;
+        m_clearRevision = ++m_revision;
     }
 
     // set frame buffer to zero
     template<class T>
     void FrameBuffer<T>::clearBuffer() {
-        T value = 0;
-        for (unsigned int i = 0; i < m_size; i++)
-            m_buffer[i] = value;
+        clearBuffer(T(0));
+    }
+
+    template<class T>
+    void FrameBuffer<T>::fastClear(const T &value) {
+        std::fill(m_clearRow, m_clearRow + CLEAR_TILE_SIZE, value);
+        std::fill(m_tilePending.begin(), m_tilePending.end(), 1);
+        m_pendingTiles = m_tilePending.size();
+        m_clearValue = value;
+        m_clearRevision = ++m_revision;
+    }
+
+    template<class T>
+    void FrameBuffer<T>::resolve() const {
+        if (m_pendingTiles)
+            resolveRect(0, 0, m_width - 1, m_height - 1);
+    }
+
+    template<class T>
+    void FrameBuffer<T>::resolveRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const {
+        if (!m_pendingTiles)
+            return;
+        unsigned int tx0, ty0, tx1, ty1;
+        tileRange(x0, y0, x1, y1, tx0, ty0, tx1, ty1);
+        withAddressing([&](const auto &addressing) {
+            for (unsigned int ty = ty0; ty <= ty1; ty++) {
+                unsigned char *pending = m_tilePending.data() + ty * m_tilesX;
+                for (unsigned int tx = tx0; tx <= tx1; tx++) {
+                    if (!pending[tx])
+                        continue;
+                    // resolve the consecutive pending tiles [tx, end) together, with longer spans
+                    unsigned int end = tx + 1;
+                    while (end <= tx1 && pending[end])
+                        end++;
+                    fillRect(addressing, tx * CLEAR_TILE_SIZE, ty * CLEAR_TILE_SIZE,
+                             std::min(end * CLEAR_TILE_SIZE, m_width) - 1, std::min((ty + 1) * CLEAR_TILE_SIZE, m_height) - 1);
+                    std::fill(pending + tx, pending + end, 0);
+                    m_pendingTiles -= end - tx;
+                    tx = end;
+                }
+            }
+        });
+    }
+
+    template<class T>
+    void FrameBuffer<T>::loadRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, T *dst, unsigned int dstStride) const {
+        withAddressing([&](const auto &addressing) {
+            const bool rowsAreContiguous = addressing.TILE_SIZE == 1;
+            for (unsigned int y = y0; y <= y1; y++) {
+                T *row = dst + (y - y0) * dstStride;
+                // one tile wide segments of the row
+                for (unsigned int x = x0; x <= x1; x = (x / CLEAR_TILE_SIZE + 1) * CLEAR_TILE_SIZE) {
+                    unsigned int end = std::min(x1 + 1, (x / CLEAR_TILE_SIZE + 1) * CLEAR_TILE_SIZE);
+                    bool pending = m_pendingTiles && m_tilePending[(y / CLEAR_TILE_SIZE) * m_tilesX + x / CLEAR_TILE_SIZE];
+                    if (pending || rowsAreContiguous)
+                        memcpy(row + (x - x0), pending ? m_clearRow : m_buffer + addressing.index(x, y), sizeof(T) * (end - x));
+                    else
+                        for (unsigned int px = x; px < end; px++)
+                            row[px - x0] = m_buffer[addressing.index(px, y)];
+                }
+            }
+        });
+    }
+
+    template<class T>
+    void FrameBuffer<T>::storeRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, const T *src, unsigned int srcStride) {
+        unsigned int tx0, ty0, tx1, ty1;
+        tileRange(x0, y0, x1, y1, tx0, ty0, tx1, ty1);
+        if (m_pendingTiles) {
+            for (unsigned int ty = ty0; ty <= ty1; ty++)
+                for (unsigned int tx = tx0; tx <= tx1; tx++) {
+                    unsigned int tile = ty * m_tilesX + tx;
+                    if (!m_tilePending[tile])
+                        continue;
+                    // the part of the tile inside the buffer
+                    unsigned int tileX1 = std::min((tx + 1) * CLEAR_TILE_SIZE, m_width) - 1;
+                    unsigned int tileY1 = std::min((ty + 1) * CLEAR_TILE_SIZE, m_height) - 1;
+                    if (tx * CLEAR_TILE_SIZE >= x0 && tileX1 <= x1 && ty * CLEAR_TILE_SIZE >= y0 && tileY1 <= y1) {
+                        m_tilePending[tile] = 0;
+                        m_pendingTiles--;
+                    }
+                    else
+                        resolveTile(tile);
+                }
+        }
+        withAddressing([&](const auto &addressing) {
+            for (unsigned int y = y0; y <= y1; y++) {
+                const T *row = src + (y - y0) * srcStride;
+                if (addressing.TILE_SIZE == 1)
+                    memcpy(m_buffer + addressing.index(x0, y), row, sizeof(T) * (x1 - x0 + 1));
+                else
+                    for (unsigned int x = x0; x <= x1; x++)
+                        m_buffer[addressing.index(x, y)] = row[x - x0];
+            }
+        });
+    }
+
+    template<class T>
+    unsigned int FrameBuffer<T>::storageSize() const {
+        unsigned int size = 0;
+        withAddressing([&](const auto &addressing) {
+            const unsigned int n = addressing.TILE_SIZE;
+            size = tilesPerRow(n) * n * ((m_height + n - 1) / n) * n;
+        });
+        return size;
+    }
+
+    template<class T>
+    void FrameBuffer<T>::fillSpan(T *p, unsigned int count) const {
+        // one tile row from m_clearRow, then double what is already filled until the span is full
+        unsigned int filled = std::min(count, +CLEAR_TILE_SIZE);
+        memcpy(p, m_clearRow, sizeof(T) * filled);
+        while (filled < count) {
+            unsigned int length = std::min(filled, count - filled);
+            memcpy(p + filled, p, sizeof(T) * length);
+            filled += length;
+        }
+    }
+
+    template<class T>
+    template<class Addressing>
+    void FrameBuffer<T>::fillRect(const Addressing &addressing, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const {
+        // the tiles of a row of tiles are consecutive in memory (a row of tiles is a row of pixels in the
+        // linear layout). Filling the padding past the edge of the buffer does no harm
+        const unsigned int n = Addressing::TILE_SIZE;
+        unsigned int length = (x1 / n - x0 / n + 1) * n * n;
+        for (unsigned int ty = y0 / n; ty <= y1 / n; ty++)
+            fillSpan(m_buffer + addressing.index(x0, ty * n), length);
+    }
+
+    template<class T>
+    void FrameBuffer<T>::allocateTiles() {
+        m_tilesX = (m_width + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+        m_tilesY = (m_height + CLEAR_TILE_SIZE - 1) / CLEAR_TILE_SIZE;
+        m_tilePending.assign(m_tilesX * m_tilesY, 0);
+        m_pendingTiles = 0;
+    }
+
+    template<class T>
+    void FrameBuffer<T>::resolveTile(unsigned int tile) const {
+        unsigned int x0 = (tile % m_tilesX) * CLEAR_TILE_SIZE, y0 = (tile / m_tilesX) * CLEAR_TILE_SIZE;
+        unsigned int x1 = std::min(x0 + CLEAR_TILE_SIZE, m_width) - 1, y1 = std::min(y0 + CLEAR_TILE_SIZE, m_height) - 1;
+        withAddressing([&](const auto &addressing) { fillRect(addressing, x0, y0, x1, y1); });
+        m_tilePending[tile] = 0;
+        m_pendingTiles--;
     }
 
 }
@@ -0,0 +1,326 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMECAPTURE_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMECAPTURE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "glm/glm.hpp"
+#include "srl_types.h"
+#include "srl_frame_buffer.h"
+
+namespace srl {
+
+    // which of the renderers drew a draw call
+    enum class RendererType : uint8_t { Points, Lines, Triangles };
+
+    // the settings of a renderer at the time of a draw call, see BasicRenderer::saveState. Plain values, so
+    // that a capture does not depend on the renderer templates. The ones a renderer does not have keep their defaults
+    struct RenderState {
+        RendererType type = RendererType::Triangles;
+        // all renderers
+        bool materializeFragments = false;
+        bool cullObjects = true;
+        bool clipToFrustum = true;
+        // triangles
+        bool cullBackFaces = true;
+        bool binned = false;
+        bool hierarchicalZ = false;
+        bool visibilityBuffer = false;
+        uint8_t rasterMode = 0;     // BasicTriangleRenderer::RasterMode
+        uint8_t passMode = 0;       // PassMode
+        float guardBand = 8.f;
+        // lines
+        bool wireframe = false;
+        // points
+        bool pointCloud = false;
+        int32_t pointSize = 1;
+
+        // number of values of the enums stored as integers
+        static const uint8_t RASTER_MODES = 2;
+        static const uint8_t PASS_MODES = 3;
+    };
+
+    // the draw calls of one or more frames, as the renderers received them, so that they can be rendered again
+    // without the application (e.g. to attach a frame to a performance bug, and replay it in srl_benchmark).
+    // Set it as the m_capture of the renderers and call beginFrame before drawing each frame. The vertex and index
+    // lists are stored once for all the draws with the same content, so a capture of many frames of the same meshes
+    // stays small.
+    // The shader and its uniforms are not captured, the frames are replayed with the ColorShader renderers, and
+    // shaders that replace the position are replayed with the default one. The file is in the byte order of the
+    // machine that wrote it
+    class FrameCapture {
+    public:
+        struct Draw {
+            RenderState state;
+            uint32_t vertexList;
+            uint32_t indexList;     // NO_INDICES when the vertices were drawn in order
+            bool depthOnly;         // drawn without a color buffer (e.g. renderDepth)
+            std::vector<glm::mat4> mvps;
+        };
+
+        struct Frame {
+            int width, height;
+            BufferLayout layout;
+            // the values the application cleared the buffers to
+            uint32_t clearColor;
+            float clearDepth;
+            std::vector<Draw> draws;
+        };
+
+        static const uint32_t NO_INDICES = 0xffffffffu;
+
+        // limits of what load accepts, larger values are taken as a corrupt file
+        static const int MAX_FRAME_SIZE = 16384;
+        static const int MAX_POINT_SIZE = 256;
+
+        // start a frame, the draws recorded until the next one render in buffers of this size and layout,
+        // cleared to clearColor and clearDepth
+        void beginFrame(int width, int height, BufferLayout layout, uint32_t clearColor, float clearDepth) {
+            m_frames.push_back(Frame {width, height, layout, clearColor, clearDepth, {}});
+        }
+
+        // called by the renderers (see BasicRenderer::m_capture), db is the depth buffer of the draw
+        void recordDraw(const RenderState &state, const std::vector<vertex> &vts, const std::vector<unsigned int> *indices,
+                        const glm::mat4 *mvps, unsigned int instanceCount, bool depthOnly, const FrameBuffer<float> &db) {
+            if (m_frames.empty())
+                throw std::runtime_error("srl::FrameCapture: beginFrame must be called before drawing");
+            Frame &frame = m_frames.back();
+            if (int(db.width()) != frame.width || int(db.height()) != frame.height || db.layout() != frame.layout)
+                throw std::runtime_error("srl::FrameCapture: the draws of a frame must use buffers of the size and layout given to beginFrame");
+
+            Draw draw {state, 0, NO_INDICES, depthOnly, std::vector<glm::mat4>(mvps, mvps + instanceCount)};
+            draw.vertexList = addList(m_vertexLists, m_vertexListIds, vts);
+            if (indices)
+                draw.indexList = addList(m_indexLists, m_indexListIds, *indices);
+            frame.draws.push_back(std::move(draw));
+        }
+
+        const std::vector<Frame> &frames() const { return m_frames; }
+        const std::vector<vertex> &vertexList(uint32_t id) const { return m_vertexLists[id]; }
+        const std::vector<unsigned int> &indexList(uint32_t id) const { return m_indexLists[id]; }
+
+        void clear() {
+            m_frames.clear();
+            m_vertexLists.clear();
+            m_indexLists.clear();
+            m_vertexListIds.clear();
+            m_indexListIds.clear();
+        }
+
+        // throws std::runtime_error if the file cannot be written
+        void save(const std::string &path) const {
+            std::ofstream out(path, std::ios::binary);
+            if (!out)
+                throw std::runtime_error("srl::FrameCapture: could not open " + path);
+            put(out, MAGIC);
+            put(out, VERSION);
+            putLists(out, m_vertexLists);
+            putLists(out, m_indexLists);
+            put(out, uint32_t(m_frames.size()));
+            for (const Frame &frame : m_frames) {
+                put(out, int32_t(frame.width));
+                put(out, int32_t(frame.height));
+                put(out, uint8_t(frame.layout));
+                put(out, frame.clearColor);
+                put(out, frame.clearDepth);
+                put(out, uint32_t(frame.draws.size()));
+                for (const Draw &draw : frame.draws) {
+                    putState(out, draw.state);
+                    put(out, draw.vertexList);
+                    put(out, draw.indexList);
+                    put(out, uint8_t(draw.depthOnly));
+                    put(out, uint32_t(draw.mvps.size()));
+                    out.write((const char *) draw.mvps.data(), draw.mvps.size() * sizeof(glm::mat4));
+                }
+            }
+            if (!out)
+                throw std::runtime_error("srl::FrameCapture: could not write " + path);
+        }
+
+        // replaces the frames with the ones in the file, throws std::runtime_error if it cannot be read. The
+        // contents are checked, so that any file that loads can be replayed: the indices must be in the vertex
+        // lists they are drawn with, and the settings in the range the renderers accept
+        void load(const std::string &path) {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in)
+                throw std::runtime_error("srl::FrameCapture: could not open " + path);
+            std::streamoff end = in.tellg();
+            in.seekg(0);
+            clear();
+            if (get<uint32_t>(in) != MAGIC || get<uint32_t>(in) != VERSION)
+                throw std::runtime_error("srl::FrameCapture: " + path + " is not a capture of this version (or byte order)");
+            getLists(in, end, m_vertexLists);
+            getLists(in, end, m_indexLists);
+            m_frames.resize(getCount(in, end, 1));
+            for (Frame &frame : m_frames) {
+                frame.width = get<int32_t>(in);
+                frame.height = get<int32_t>(in);
+                uint8_t layout = get<uint8_t>(in);
+                frame.layout = BufferLayout(layout);
+                frame.clearColor = get<uint32_t>(in);
+                frame.clearDepth = get<float>(in);
+                frame.draws.resize(getCount(in, end, 1));
+                if (layout > uint8_t(BufferLayout::Morton) || frame.width <= 0 || frame.height <= 0 ||
+                    frame.width > MAX_FRAME_SIZE || frame.height > MAX_FRAME_SIZE)
+                    throw std::runtime_error("srl::FrameCapture: " + path + " is corrupt");
+                for (Draw &draw : frame.draws) {
+                    draw.state = getState(in);
+                    draw.vertexList = get<uint32_t>(in);
+                    draw.indexList = get<uint32_t>(in);
+                    draw.depthOnly = get<uint8_t>(in) != 0;
+                    draw.mvps.resize(getCount(in, end, sizeof(glm::mat4)));
+                    in.read((char *) draw.mvps.data(), draw.mvps.size() * sizeof(glm::mat4));
+                    if (draw.state.type > RendererType::Triangles || draw.vertexList >= m_vertexLists.size() ||
+                        (draw.indexList != NO_INDICES && draw.indexList >= m_indexLists.size()))
+                        throw std::runtime_error("srl::FrameCapture: " + path + " is corrupt");
+                }
+            }
+            if (!in)
+                throw std::runtime_error("srl::FrameCapture: " + path + " is truncated");
+            if (!valid())
+                throw std::runtime_error("srl::FrameCapture: " + path + " is corrupt");
+        }
+
+    private:
+        static const uint32_t MAGIC = 0x434c5253u;     // "SRLC"
+        static const uint32_t VERSION = 1;
+
+        // the lists are written as they are in memory
+        static_assert(sizeof(vertex) == 11 * sizeof(float), "srl::vertex must not have padding");
+
+        // the draws of a loaded capture only refer to vertices they have, with settings the renderers accept
+        bool valid() const {
+            // the largest index of each list, the vertex lists drawn with it must be larger
+            std::vector<uint64_t> ends(m_indexLists.size(), 0);
+            for (unsigned int i = 0; i < m_indexLists.size(); i++)
+                for (unsigned int index : m_indexLists[i])
+                    ends[i] = std::max(ends[i], uint64_t(index) + 1);
+
+            for (const Frame &frame : m_frames)
+                for (const Draw &draw : frame.draws) {
+                    const RenderState &state = draw.state;
+                    if (draw.indexList != NO_INDICES && ends[draw.indexList] > m_vertexLists[draw.vertexList].size())
+                        return false;
+                    if (state.rasterMode >= RenderState::RASTER_MODES || state.passMode >= RenderState::PASS_MODES ||
+                        state.pointSize < 0 || state.pointSize > MAX_POINT_SIZE ||
+                        !std::isfinite(state.guardBand) || state.guardBand <= 0.f)
+                        return false;
+                    // only the triangle renderer draws without a color buffer
+                    if (draw.depthOnly && state.type != RendererType::Triangles)
+                        return false;
+                }
+            return true;
+        }
+
+        // FNV-1a of the bytes of the list
+        template<class T>
+        static uint64_t hash(const std::vector<T> &list) {
+            uint64_t h = 14695981039346656037ull;
+            const unsigned char *bytes = (const unsigned char *) list.data();
+            for (std::size_t i = 0, size = list.size() * sizeof(T); i < size; i++) {
+                h ^= bytes[i];
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        // the id of the stored list with the content of list, which is stored if there is none
+        template<class T>
+        static uint32_t addList(std::vector<std::vector<T> > &lists, std::unordered_multimap<uint64_t, uint32_t> &ids,
+                                const std::vector<T> &list) {
+            uint64_t h = hash(list);
+            auto range = ids.equal_range(h);
+            for (auto it = range.first; it != range.second; ++it) {
+                const std::vector<T> &stored = lists[it->second];
+                if (stored.size() == list.size() && std::memcmp(stored.data(), list.data(), list.size() * sizeof(T)) == 0)
+                    return it->second;
+            }
+            uint32_t id = lists.size();
+            lists.push_back(list);
+            ids.emplace(h, id);
+            return id;
+        }
+
+        template<class T>
+        static void put(std::ostream &out, T value) { out.write((const char *) &value, sizeof(T)); }
+
+        template<class T>
+        static T get(std::istream &in) {
+            T value {};
+            in.read((char *) &value, sizeof(T));
+            return value;
+        }
+
+        template<class T>
+        static void putLists(std::ostream &out, const std::vector<std::vector<T> > &lists) {
+            put(out, uint32_t(lists.size()));
+            for (const std::vector<T> &list : lists) {
+                put(out, uint32_t(list.size()));
+                out.write((const char *) list.data(), list.size() * sizeof(T));
+            }
+        }
+
+        // a count of elements of elementSize bytes, that must fit in what is left of the file (end is its size), so
+        // that a corrupt file does not make us allocate more than it holds
+        static uint32_t getCount(std::istream &in, std::streamoff end, std::size_t elementSize) {
+            uint32_t count = get<uint32_t>(in);
+            if (!in || std::streamoff(count) * std::streamoff(elementSize) > end - std::streamoff(in.tellg()))
+                throw std::runtime_error("srl::FrameCapture: the capture is truncated or corrupt");
+            return count;
+        }
+
+        template<class T>
+        static void getLists(std::istream &in, std::streamoff end, std::vector<std::vector<T> > &lists) {
+            lists.resize(getCount(in, end, sizeof(uint32_t)));
+            for (std::vector<T> &list : lists) {
+                list.resize(getCount(in, end, sizeof(T)));
+                in.read((char *) list.data(), list.size() * sizeof(T));
+            }
+        }
+
+        // the flags packed in a 16 bits mask
+        static void putState(std::ostream &out, const RenderState &state) {
+            const bool flags[] = {state.materializeFragments, state.cullObjects, state.clipToFrustum, state.cullBackFaces,
+                                  state.binned, state.hierarchicalZ, state.visibilityBuffer, state.wireframe, state.pointCloud};
+            uint16_t mask = 0;
+            for (unsigned int i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+                mask |= uint16_t(flags[i]) << i;
+            put(out, uint8_t(state.type));
+            put(out, mask);
+            put(out, state.rasterMode);
+            put(out, state.passMode);
+            put(out, state.guardBand);
+            put(out, state.pointSize);
+        }
+
+        static RenderState getState(std::istream &in) {
+            RenderState state;
+            state.type = RendererType(get<uint8_t>(in));
+            uint16_t mask = get<uint16_t>(in);
+            bool *flags[] = {&state.materializeFragments, &state.cullObjects, &state.clipToFrustum, &state.cullBackFaces,
+                             &state.binned, &state.hierarchicalZ, &state.visibilityBuffer, &state.wireframe, &state.pointCloud};
+            for (unsigned int i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+                *flags[i] = (mask >> i) & 1;
+            state.rasterMode = get<uint8_t>(in);
+            state.passMode = get<uint8_t>(in);
+            state.guardBand = get<float>(in);
+            state.pointSize = get<int32_t>(in);
+            return state;
+        }
+
+        std::vector<Frame> m_frames;
+        std::vector<std::vector<vertex> > m_vertexLists;
+        std::vector<std::vector<unsigned int> > m_indexLists;
+        // content hash of the lists to their ids, only used while recording
+        std::unordered_multimap<uint64_t, uint32_t> m_vertexListIds, m_indexListIds;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLFRAMECAPTURE_H
@@ -6,70 +6,103 @@
 #define GRAPHICSPROGRAMMINGEXERCISES_OGLLINERENDERER_H
 
 #include "srl_renderer.h"
+#include "srl_edge_list.h"
 #include "rasterizer/linerasterizer.h"
 
 namespace srl {
 
-    class LineRenderer : public Renderer {
+    template<class Shader>
+    class BasicLineRenderer : public BasicRenderer<Shader> {
     public:
+        typedef BasicRenderer<Shader> Base;
+        using typename Base::Varyings;
+        using typename Base::Vertex;
+        using Base::m_shader;
+        using Base::m_materializeFragments;
+
         bool m_clipToFrustum = true;
 
+        // draw the edges of the triangles of the vertex stream, instead of a line per pair of vertices.
+        // Edges shared by several triangles are drawn once (see EdgeList)
+        bool m_wireframe = false;
+
+        void saveState(RenderState &state) const override {
+            Base::saveState(state);
+            state.type = RendererType::Lines;
+            state.clipToFrustum = m_clipToFrustum;
+            state.wireframe = m_wireframe;
+        }
+        void loadState(const RenderState &state) override {
+            Base::loadState(state);
+            m_clipToFrustum = state.clipToFrustum;
+            m_wireframe = state.wireframe;
+        }
+
     private:
-        void processPrimitives (const std::vector<vertex> &inVts, unsigned int width, unsigned int height, std::vector<fragment> &outFrs) override{
+        using Base::arena;
+        using Base::stats;
+
+        void processPrimitives (const VertexStream<Varyings> &inVts, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db, ArenaVector<fragment> &outFrs) override{
+            SRL_STATS(StageClock clock(stats()));
+
             // 2.1. create the primitives
             assemblePrimitives(inVts);
+            SRL_STATS(stats().primitivesAssembled += m_primitives.size(); clock.lap(PipelineStats::ASSEMBLY));
 
             // 2.2. keep primitives in the visible volume
-            if(m_clipToFrustum)
+            if(m_clipToFrustum && !inVts.inside)
                 clipPrimitives();
-
-            // NEW!
-            // scale down the primitives so that the clipping is visible in the screen space
-            // TODO can be removed once clipping is working
-            glm::mat4 scale = glm::scale(0.75f, 0.75f, 0.75f);
-            for (auto & line : m_primitives) {
-                line.v1.pos = scale * line.v1.pos;
-                line.v2.pos = scale * line.v2.pos;
-            }
+            SRL_STATS(clock.lap(PipelineStats::CLIPPING));
 
             // 2.3. move vertices to normalized device coordinates
             divideByW();
 
             // 2.4. normalized device coordinates to screen space
-            toScreenSpace(width, height);
+            toScreenSpace(fb.width(), fb.height());
 
             // 2.5. NO back-face culling for points
+            SRL_STATS(clock.lap(PipelineStats::SETUP));
 
             // 2.6. rasterization (generate fragments)
-            rasterPrimitives(outFrs);
+            if(m_materializeFragments) {
+                FragmentList output {outFrs};
+                rasterPrimitives(output);
+            }
+            else {
+                withFrameBufferWriter(fb, db, &stats(), [&](auto &output) { rasterPrimitives(output); });
+            }
+            SRL_STATS(clock.lap(PipelineStats::RASTERIZATION));
         }
 
 
         // 2.1. create line primitives
-        void assemblePrimitives(const std::vector<vertex> &vts) {
-            m_primitives.clear();
+        void assemblePrimitives(const VertexStream<Varyings> &vts) {
+            arena().prepare(m_primitives);
+            line<Vertex> l;
+            if(m_wireframe) {
+                // one line per unique edge of the triangles
+                const std::vector<Edge> &edges = m_edges.edges(vts.vertices, vts.indices);
+                m_primitives.reserve(edges.size());
+                for(const Edge &edge : edges){
+                    l.v1 = vts[edge.v1];
+                    l.v2 = vts[edge.v2];
+                    m_primitives.push_back(l);
+                }
+                return;
+            }
             // make sure a single allocation will happen
-            m_primitives.reserve(vts.size()/3 * (wireframe ? 3 : 1));
-            int increment =  wireframe ? 3 : 2;
-            for(int i = 0, size = vts.size()-1; i < size; i += increment){
-                line l;
+            m_primitives.reserve(vts.size()/2);
+            for(int i = 0, size = vts.size()-1; i < size; i += 2){
                 l.v1 = vts[i];
                 l.v2 = vts[i+1];
                 m_primitives.push_back(l);
-                if(wireframe) {
-                    l.v1 = vts[i + 1];
-                    l.v2 = vts[i + 2];
-                    m_primitives.push_back(l);
-                    l.v1 = vts[i + 2];
-                    l.v2 = vts[i];
-                    m_primitives.push_back(l);
-                }
             }
         }
 
-        void clipLine(line &l, int side){
-            vertex &v1 = l.v1;
-            vertex &v2 = l.v2;
+        // returns true if l crossed the plane and was clipped
+        bool clipLine(line<Vertex> &l, int side){
+            Vertex &v1 = l.v1;
+            Vertex &v2 = l.v2;
 
             // index to x, y or z coordinate (x=0, y=1, z=2)
             int idx = side % 3;
@@ -86,11 +119,11 @@ namespace srl {
             if( outCount == 2){
                 // the line is outside the frustum, we don't need to draw it
                 l.rejected = true;
-                return;
+                return false;
             }
             else if (outCount == 0){
                 // no need to clip against this plane
-                return;
+                return false;
             }
             else { // (outCount == 1)  one vertex is inside and the other is outside
 
@@ -102,19 +135,22 @@ namespace srl {
                 float t = (p1[idx] - p1.w * wMult) / denom;
 
                 // interpolate and update the value of one of the variables
-                vertex &vTarget = p1[idx] * wMult > p1.w ? v1 : v2;
+                Vertex &vTarget = p1[idx] * wMult > p1.w ? v1 : v2;
                 vTarget = v1 + (v2 - v1) * t;
+                return true;
             }
         }
 
         // 2.2. clip primitives so that they are contained within the render frustum
         void clipPrimitives()  {
-            // repeat for the six planes of the viewing frustum
-            for (int side = 0; side < 6; side ++){
-                for(int i = 0, size = m_primitives.size(); i < size; i++){
-                    if (!m_primitives[i].rejected)
-                        clipLine(m_primitives[i], side);
-                }
+            for(int i = 0, size = m_primitives.size(); i < size; i++){
+                line<Vertex> &l = m_primitives[i];
+                bool clipped = false;
+                // repeat for the six planes of the viewing frustum
+                for (int side = 0; side < 6 && !l.rejected; side ++)
+                    clipped |= clipLine(l, side);
+                SRL_STATS(stats().primitivesRejected += l.rejected; stats().primitivesClipped += clipped && !l.rejected;)
+                (void) clipped;
             }
         }
 
@@ -130,8 +166,8 @@ namespace srl {
 
         // 2.4. normalized device coordinates to screen space
         void toScreenSpace(int width, int height)  {
-            float halfW = width / 2;
-            float halfH = width / 2;
+            float halfW = width / 2.f;
+            float halfH = height / 2.f;
             glm::mat4 toWindowSpace = glm::scale(halfW, halfH, 1.f) * glm::translate(1.f, 1.f, 0.f);
             for(auto &line : m_primitives) {
                 line.v1.pos = toWindowSpace * line.v1.pos;
@@ -139,40 +175,48 @@ namespace srl {
             }
         }
 
-        // 2.6. rasterization (generate fragments)
-        void rasterPrimitives(std::vector<fragment> &outFrs) {
-            outFrs.clear();
-
+        // 2.6. rasterization (generate fragments and send them to output). The rasterizer gives runs of pixels
+        // and the vertex at their start, the depth of each pixel is interpolated on its own, and the varyings
+        // only if the fragment passes the test
+        template<class Output>
+        void rasterPrimitives(Output &output) {
+            SRL_STATS(uint64_t generated = 0;)
             for(auto &line : m_primitives) {
                 // skip current primitive?
                 if(line.rejected)
                     continue;
 
-                LineRasterizer rasterizer(line.v1, line.v2);
-
-                while (rasterizer.MoreFragments()) {
-                    srl::fragment frag;
-
-                    frag.posX = rasterizer.x();
-                    frag.posY = rasterizer.y();
-
-                    vertex vtx = rasterizer.GetCurrent();
-                    vtx = vtx/vtx.one; // hyperbolic interpolation
-                    frag.depth = vtx.pos.z;
-                    frag.col = vtx.col;
-
-                    outFrs.push_back(frag);
-                    rasterizer.NextFragment();
+                LineRasterizer<Vertex> rasterizer(line.v1, line.v2);
+
+                for (; rasterizer.MoreSpans(); rasterizer.NextSpan()) {
+                    int posX = rasterizer.span_x(), posY = rasterizer.span_y();
+                    int dx = rasterizer.span_dx(), dy = rasterizer.span_dy();
+                    int length = rasterizer.span_length();
+                    SRL_STATS(generated += length;)
+                    Vertex start = rasterizer.SpanStart();
+                    Vertex step = rasterizer.SpanStep();
+
+                    for (int i = 0; i < length; i++, posX += dx, posY += dy) {
+                        // hyperbolic interpolation
+                        float invOne = 1.f / (start.one + step.one * float(i));
+                        float depth = (start.pos.z + step.pos.z * float(i)) * invOne;
+                        if (output.test(posX, posY, depth))
+                            output.write(posX, posY, depth, shadeFragment(m_shader, (start.var + step.var * float(i)) * invOne));
+                    }
                 }
             }
+            SRL_STATS(stats().fragmentsGenerated += generated;)
         }
 
 
         // lists of line primitives.
-        std::vector<line> m_primitives;
-        bool wireframe = false;
+        ArenaVector<line<Vertex> > m_primitives;
+        // unique edges of the meshes drawn in wireframe
+        EdgeList m_edges;
     };
 
+    typedef BasicLineRenderer<ColorShader> LineRenderer;
+
 }
 
 #endif //GRAPHICSPROGRAMMINGEXERCISES_OGLLINERENDERER_H
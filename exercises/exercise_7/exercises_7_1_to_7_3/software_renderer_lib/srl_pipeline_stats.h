@@ -0,0 +1,167 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLPIPELINESTATS_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLPIPELINESTATS_H
+
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+
+// the counters and timers are only recorded when SRL_PIPELINE_STATS is defined (e.g. cmake -DSRL_PIPELINE_STATS=ON).
+// Otherwise SRL_STATS(...) expands to nothing and the pipeline does not pay for them
+#ifdef SRL_PIPELINE_STATS
+#define SRL_STATS(...) __VA_ARGS__
+#else
+#define SRL_STATS(...)
+#endif
+
+namespace srl {
+
+    // what went through the pipeline since the renderer was reset (at beginFrame, or at each render call
+    // made outside of beginFrame/endFrame), and how long each stage took
+    struct PipelineStats {
+
+        enum Stage {
+            VERTEX,         // 1. vertex transformation
+            ASSEMBLY,       // 2.1. primitive assembly
+            CLIPPING,       // 2.2. clipping
+            SETUP,          // 2.3. to 2.5. perspective division, screen space and culling (which runs before clipping)
+            RASTERIZATION,  // 2.6. rasterization, including binning and the hierarchical z-buffer
+            FRAGMENT,       // 4. writing the fragment list to the frame buffer (the fragment shader runs in rasterization),
+                            // or shading the visibility buffer
+            STAGE_COUNT
+        };
+
+        static const bool ENABLED =
+#ifdef SRL_PIPELINE_STATS
+            true;
+#else
+            false;
+#endif
+
+        uint64_t drawCalls = 0;
+        uint64_t instances = 0;
+        // instances skipped because their bounds were outside of the view volume, and instances that were
+        // not clipped because their bounds were inside of it (see BasicRenderer::m_cullObjects)
+        uint64_t instancesCulled = 0;
+        uint64_t instancesInside = 0;
+        // vertices transformed by the vertex stage (once per instance)
+        uint64_t verticesIn = 0;
+        // primitives created by primitive assembly
+        uint64_t primitivesAssembled = 0;
+        // primitives that crossed a plane of the view volume and had to be clipped
+        uint64_t primitivesClipped = 0;
+        // primitives rejected by back-face culling
+        uint64_t primitivesCulled = 0;
+        // primitives rejected for being outside of the view volume
+        uint64_t primitivesRejected = 0;
+        // triangles rejected for covering no pixel center (no area once snapped to the pixel grid)
+        uint64_t primitivesDegenerate = 0;
+        // triangles skipped by the hierarchical z-buffer (when binned, counted once per tile)
+        uint64_t primitivesOccluded = 0;
+        // fragments produced by the rasterizers, and what happened to them in the depth test
+        // (fragments outside of the frame buffer count as failed)
+        uint64_t fragmentsGenerated = 0;
+        uint64_t fragmentsDepthFailed = 0;
+        uint64_t fragmentsWritten = 0;
+        // size of the frame buffer of the last render call
+        uint64_t pixels = 0;
+
+        uint64_t stageNs[STAGE_COUNT] = {};
+
+        static const char *stageName(int stage) {
+            static const char *names[STAGE_COUNT] = {"vertex", "assembly", "clipping", "setup", "rasterization", "fragment"};
+            return names[stage];
+        }
+
+        void reset() { *this = PipelineStats(); }
+
+        // average number of times each pixel was written
+        double overdraw() const { return pixels ? double(fragmentsWritten) / double(pixels) : 0.0; }
+
+        double stageMs(int stage) const { return stageNs[stage] * 1e-6; }
+
+        double totalMs() const {
+            uint64_t total = 0;
+            for (int stage = 0; stage < STAGE_COUNT; stage++)
+                total += stageNs[stage];
+            return total * 1e-6;
+        }
+
+        void writeJson(std::ostream &out) const {
+            out << "{";
+            forCounters([&](const char *name, uint64_t value, bool first) {
+                out << (first ? "" : ", ") << "\"" << name << "\": " << value;
+            });
+            out << ", \"overdraw\": " << overdraw() << ", \"stagesMs\": {";
+            for (int stage = 0; stage < STAGE_COUNT; stage++)
+                out << (stage ? ", " : "") << "\"" << stageName(stage) << "\": " << stageMs(stage);
+            out << "}, \"totalMs\": " << totalMs() << "}";
+        }
+
+        // one line with the names of the columns written by writeCsvRow
+        static void writeCsvHeader(std::ostream &out) {
+            PipelineStats().forCounters([&](const char *name, uint64_t, bool first) {
+                out << (first ? "" : ",") << name;
+            });
+            out << ",overdraw";
+            for (int stage = 0; stage < STAGE_COUNT; stage++)
+                out << "," << stageName(stage) << "Ms";
+            out << ",totalMs\n";
+        }
+
+        void writeCsvRow(std::ostream &out) const {
+            forCounters([&](const char *, uint64_t value, bool first) {
+                out << (first ? "" : ",") << value;
+            });
+            out << "," << overdraw();
+            for (int stage = 0; stage < STAGE_COUNT; stage++)
+                out << "," << stageMs(stage);
+            out << "," << totalMs() << "\n";
+        }
+
+    private:
+
+        // call visit(name, value, first) for each counter, in the order they are written out
+        template<class Visit>
+        void forCounters(Visit &&visit) const {
+            visit("drawCalls", drawCalls, true);
+            visit("instances", instances, false);
+            visit("instancesCulled", instancesCulled, false);
+            visit("instancesInside", instancesInside, false);
+            visit("verticesIn", verticesIn, false);
+            visit("primitivesAssembled", primitivesAssembled, false);
+            visit("primitivesClipped", primitivesClipped, false);
+            visit("primitivesCulled", primitivesCulled, false);
+            visit("primitivesRejected", primitivesRejected, false);
+            visit("primitivesDegenerate", primitivesDegenerate, false);
+            visit("primitivesOccluded", primitivesOccluded, false);
+            visit("fragmentsGenerated", fragmentsGenerated, false);
+            visit("fragmentsDepthFailed", fragmentsDepthFailed, false);
+            visit("fragmentsWritten", fragmentsWritten, false);
+            visit("pixels", pixels, false);
+        }
+    };
+
+    // adds the time between consecutive laps to the stages of a PipelineStats:
+    //   SRL_STATS(StageClock clock(stats));
+    //   assemblePrimitives(...);
+    //   SRL_STATS(clock.lap(PipelineStats::ASSEMBLY));
+    class StageClock {
+    public:
+        explicit StageClock(PipelineStats &stats) : m_stats(stats), m_last(Clock::now()) {}
+
+        // the time since the previous lap (or since construction) goes to stage
+        inline void lap(PipelineStats::Stage stage) {
+            Clock::time_point now = Clock::now();
+            m_stats.stageNs[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last).count();
+            m_last = now;
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+        PipelineStats &m_stats;
+        Clock::time_point m_last;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLPIPELINESTATS_H
@@ -5,50 +5,103 @@
 #ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLPOINTRENDERER_H
 #define GRAPHICSPROGRAMMINGEXERCISES_OGLPOINTRENDERER_H
 
+#include <atomic>
+#include <memory>
+#include <cstring>
 #include "srl_renderer.h"
+#include "srl_thread_pool.h"
 
 namespace srl {
 
-    class PointRenderer : public Renderer {
+    template<class Shader>
+    class BasicPointRenderer : public BasicRenderer<Shader> {
     public:
+        typedef BasicRenderer<Shader> Base;
+        using typename Base::Varyings;
+        using typename Base::Vertex;
+        using Base::m_shader;
+        using Base::m_materializeFragments;
+
         bool m_clipToFrustum = true;
 
+        // width and height of the square of pixels covered by each point
+        int m_pointSize = 1;
+
+        // point clouds (e.g. scan data, millions of points): the points go straight from the vertex stage to
+        // the frame buffer, without primitives or fragments. Each point is packed with its depth in 64 bits,
+        // and the points are splatted in parallel with an atomic min, so where several points land on the same
+        // pixel the closest one wins (the smallest color if they are at the same depth). Points outside of the
+        // view volume are always rejected, and m_materializeFragments is ignored
+        bool m_pointCloud = false;
+
+        // points splatted by each task of the point cloud path
+        static const unsigned int POINT_CLOUD_BATCH = 16384;
+        // size of the (square) screen tiles the point cloud path copies from and to the frame buffer
+        static const int TILE_SIZE = 64;
+
+        void saveState(RenderState &state) const override {
+            Base::saveState(state);
+            state.type = RendererType::Points;
+            state.clipToFrustum = m_clipToFrustum;
+            state.pointCloud = m_pointCloud;
+            state.pointSize = m_pointSize;
+        }
+        void loadState(const RenderState &state) override {
+            Base::loadState(state);
+            m_clipToFrustum = state.clipToFrustum;
+            m_pointCloud = state.pointCloud;
+            m_pointSize = state.pointSize;
+        }
+
     private:
-        void processPrimitives (const std::vector<vertex> &inVts, unsigned int width, unsigned int height, std::vector<fragment> &outFrs) override{
+        using Base::arena;
+        using Base::stats;
+
+        void processPrimitives (const VertexStream<Varyings> &inVts, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db, ArenaVector<fragment> &outFrs) override{
+            if(m_pointCloud) {
+                renderPointCloud(inVts, fb, db);
+                return;
+            }
+
+            SRL_STATS(StageClock clock(stats()));
+
             // 2.1. create the primitives
             assemblePrimitives(inVts);
+            SRL_STATS(stats().primitivesAssembled += m_primitives.size(); clock.lap(PipelineStats::ASSEMBLY));
 
             // 2.2. keep primitives in the visible volume
-            if(m_clipToFrustum)
-                clipPrimitives();
-
-            // NEW!
-            // scale down the primitives so that the clipping is visible in the screen space
-            // TODO can be removed once clipping is working
-            glm::mat4 scale = glm::scale(0.75f, 0.75f, 0.75f);
-            for (auto & point : m_primitives) {
-                point.v.pos = scale * point.v.pos;
-            }
+            if(m_clipToFrustum && !inVts.inside)
+                clipPrimitives(inVts);
+            SRL_STATS(clock.lap(PipelineStats::CLIPPING));
 
             // 2.3. move vertices to normalized device coordinates
             divideByW();
 
             // 2.4. normalized device coordinates to screen space
-            toScreenSpace(width, height);
+            toScreenSpace(fb.width(), fb.height());
 
             // 2.5. NO back-face culling for points
+            SRL_STATS(clock.lap(PipelineStats::SETUP));
 
             // 2.6. rasterization (generate fragments)
-            rasterPrimitives(outFrs);
+            if(m_materializeFragments) {
+                FragmentList output {outFrs};
+                if(outFrs.empty()) outFrs.reserve(m_primitives.size());
+                rasterPrimitives(output);
+            }
+            else {
+                withFrameBufferWriter(fb, db, &stats(), [&](auto &output) { rasterPrimitives(output); });
+            }
+            SRL_STATS(clock.lap(PipelineStats::RASTERIZATION));
         }
 
         // 2.1. create point primitives
-        void assemblePrimitives(const std::vector<vertex> &vts) {
-            m_primitives.clear();
+        void assemblePrimitives(const VertexStream<Varyings> &vts) {
+            arena().prepare(m_primitives);
             m_primitives.reserve(vts.size());
 
             for(int i = 0, size = vts.size(); i < size; i++){
-                point p;
+                point<Vertex> p;
                 p.v = vts[i];
 
                 m_primitives.push_back(p);
@@ -56,12 +109,13 @@ namespace srl {
         }
 
         // 2.2. reject points that are out of the render volume
-        void clipPrimitives() {
-            for(auto it = m_primitives.begin(); it < m_primitives.end(); it++){
-                glm::vec4 pos = it->v.pos;
-                // we only want to render points with x,y and z in the range [-w,w]
-                if( abs(pos.x) > abs(pos.w) || abs(pos.y) > abs(pos.w) || abs(pos.z) > abs(pos.w) ) {
-                    it->rejected = true;
+        void clipPrimitives(const VertexStream<Varyings> &vts) {
+            // point i is vertex i of the stream, we only want to render points with x,y and z in the range [-w,w],
+            // which is what the outcodes of the vertex stage tell us
+            for(int i = 0, size = m_primitives.size(); i < size; i++){
+                if(vts.outcode(i) != 0) {
+                    m_primitives[i].rejected = true;
+                    SRL_STATS(stats().primitivesRejected++;)
                 }
             }
         }
@@ -76,40 +130,206 @@ namespace srl {
 
         // 2.4. normalized device coordinates to screen space
         void toScreenSpace(int width, int height)  {
-            float halfW = width / 2;
-            float halfH = width / 2;
+            float halfW = width / 2.f;
+            float halfH = height / 2.f;
             glm::mat4 toWindowSpace = glm::scale(halfW, halfH, 1.f) * glm::translate(1.f, 1.f, 0.f);
             for(auto &point : m_primitives) {
                 point.v.pos = toWindowSpace * point.v.pos;
             }
         }
 
-        // 2.6. rasterization (generate fragments)
-        void rasterPrimitives(std::vector<fragment> &outFrs) {
-            outFrs.clear();
-            outFrs.reserve(m_primitives.size());
-
+        // 2.6. rasterization (generate fragments and send them to output)
+        template<class Output>
+        void rasterPrimitives(Output &output) {
             // convert points into fragments
             for(auto &point : m_primitives) {
                 if (point.rejected)
                     continue;
+                SRL_STATS(stats().fragmentsGenerated += m_pointSize * m_pointSize;)
 
-                fragment fr;
-                vertex v = point.v;
-                fr.posX = (int) (v.pos.x + .5f);
-                fr.posY = (int) (v.pos.y + .5f);
+                Vertex v = point.v;
+                int x0 = firstPixel(v.pos.x);
+                int y0 = firstPixel(v.pos.y);
 
                 v = v/v.one; // hyperbolic interpolation
-                fr.depth = v.pos.z;
-                fr.col = v.col;
+                for (int posY = y0; posY < y0 + m_pointSize; posY++)
+                    for (int posX = x0; posX < x0 + m_pointSize; posX++)
+                        if (output.test(posX, posY, v.pos.z))
+                            output.write(posX, posY, v.pos.z, shadeFragment(m_shader, v.var));
+            }
+        }
+
+        // first pixel (column or row) of the square of a point at screen coordinate p, the pixels closest to p
+        inline int firstPixel(float p) const {
+            // floor, without a call to the library
+            float first = p + 1.f - m_pointSize * .5f;
+            int pixel = (int) first;
+            return pixel - (first < (float) pixel);
+        }
 
-                outFrs.push_back(fr);
+        // the point cloud path, all the stages at once
+        void renderPointCloud(const VertexStream<Varyings> &vts, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
+            SRL_STATS(StageClock clock(stats()));
+            int width = fb.width(), height = fb.height();
+            int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE, tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+            // the splat buffer starts with the depth of db and no color, so that a point only replaces the
+            // pixel if it is closer, as with the depth test of the other paths
+            unsigned int pixels = width * height;
+            if (pixels > m_splatSize) {
+                m_splats.reset(new std::atomic<uint64_t>[pixels]);
+                m_splatSize = pixels;
+            }
+            if (unsigned(tilesX * tilesY) > m_tileCount) {
+                m_touched.reset(new std::atomic<uint8_t>[tilesX * tilesY]);
+                m_tileCount = tilesX * tilesY;
             }
+            m_tilesX = tilesX;
+            ThreadPool::shared().parallelFor(tilesX * tilesY, [&](unsigned int tile, unsigned int) {
+                m_touched[tile].store(0, std::memory_order_relaxed);
+                int x0, y0, x1, y1;
+                tileRect(tile, tilesX, width, height, x0, y0, x1, y1);
+                float depths[TILE_SIZE * TILE_SIZE];
+                db.loadRect(x0, y0, x1, y1, depths, TILE_SIZE);
+                for (int y = y0; y <= y1; y++)
+                    for (int x = x0; x <= x1; x++)
+                        m_splats[y * width + x].store(packSplat(depths[(y - y0) * TILE_SIZE + (x - x0)], 0), std::memory_order_relaxed);
+            });
+
+            // 1. to 2.6. splat the points of each batch
+            unsigned int count = vts.size();
+            SRL_STATS(std::atomic<uint64_t> rejected(0);)
+            ThreadPool::shared().parallelFor((count + POINT_CLOUD_BATCH - 1) / POINT_CLOUD_BATCH, [&](unsigned int batch, unsigned int) {
+                unsigned int begin = batch * POINT_CLOUD_BATCH, end = std::min(begin + POINT_CLOUD_BATCH, count);
+                SRL_STATS(uint64_t batchRejected = 0;)
+                float sx[4], sy[4], depth[4];
+                for (unsigned int i = begin; i < end; i += 4) {
+                    unsigned int lanes = std::min(end - i, 4u);
+                    toScreen(vts, i, lanes, width, height, sx, sy, depth);
+                    for (unsigned int lane = 0; lane < lanes; lane++) {
+                        if (vts.outcode(i + lane) != 0) {
+                            SRL_STATS(batchRejected++;)
+                            continue;
+                        }
+                        uint32_t col = shadeFragment(m_shader, vts.varyings[vts.index(i + lane)]).getRGBA32();
+                        splat(sx[lane], sy[lane], packSplat(depth[lane], col), width, height);
+                    }
+                }
+                SRL_STATS(rejected += batchRejected;)
+            });
+            SRL_STATS(stats().primitivesAssembled += count; stats().primitivesRejected += rejected;
+                      stats().fragmentsGenerated += (count - rejected) * m_pointSize * m_pointSize;
+                      clock.lap(PipelineStats::RASTERIZATION));
+
+            // 4. copy the pixels that a point replaced to fb and db, in the tiles points were splatted to
+            SRL_STATS(std::atomic<uint64_t> written(0);)
+            ThreadPool::shared().parallelFor(tilesX * tilesY, [&](unsigned int tile, unsigned int) {
+                if (!m_touched[tile].load(std::memory_order_relaxed))
+                    return;
+                int x0, y0, x1, y1;
+                tileRect(tile, tilesX, width, height, x0, y0, x1, y1);
+                uint32_t colors[TILE_SIZE * TILE_SIZE];
+                float depths[TILE_SIZE * TILE_SIZE];
+                fb.loadRect(x0, y0, x1, y1, colors, TILE_SIZE);
+                db.loadRect(x0, y0, x1, y1, depths, TILE_SIZE);
+                SRL_STATS(uint64_t tileWritten = 0;)
+                for (int y = y0; y <= y1; y++)
+                    for (int x = x0; x <= x1; x++) {
+                        uint64_t value = m_splats[y * width + x].load(std::memory_order_relaxed);
+                        int local = (y - y0) * TILE_SIZE + (x - x0);
+                        if (value == packSplat(depths[local], 0))
+                            continue;
+                        colors[local] = uint32_t(value);
+                        depths[local] = unpackDepth(value);
+                        SRL_STATS(tileWritten++;)
+                    }
+                fb.storeRect(x0, y0, x1, y1, colors, TILE_SIZE);
+                db.storeRect(x0, y0, x1, y1, depths, TILE_SIZE);
+                SRL_STATS(written += tileWritten;)
+            });
+            SRL_STATS(stats().fragmentsWritten += written; clock.lap(PipelineStats::FRAGMENT));
+        }
+
+        inline void tileRect(unsigned int tile, int tilesX, int width, int height, int &x0, int &y0, int &x1, int &y1) const {
+            x0 = (tile % tilesX) * TILE_SIZE;
+            y0 = (tile / tilesX) * TILE_SIZE;
+            x1 = std::min(x0 + TILE_SIZE, width) - 1;
+            y1 = std::min(y0 + TILE_SIZE, height) - 1;
+        }
+
+        // screen coordinates and depth of points i to i + lanes - 1 of the stream, as in divideByW and
+        // toScreenSpace. Four at a time when the stream has no indices
+        void toScreen(const VertexStream<Varyings> &vts, unsigned int i, unsigned int lanes, int width, int height,
+                      float *sx, float *sy, float *depth) const {
+            float halfW = width / 2.f;
+            float halfH = height / 2.f;
+#ifdef SRL_USE_SSE
+            if (lanes == 4 && !vts.indices) {
+                __m128 w = _mm_loadu_ps(&vts.clip.w[i]);
+                __m128 hw = _mm_set1_ps(halfW), hh = _mm_set1_ps(halfH);
+                _mm_storeu_ps(sx, _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_loadu_ps(&vts.clip.x[i]), w), hw), hw));
+                _mm_storeu_ps(sy, _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_loadu_ps(&vts.clip.y[i]), w), hh), hh));
+                _mm_storeu_ps(depth, _mm_div_ps(_mm_loadu_ps(&vts.clip.z[i]), w));
+                return;
+            }
+#endif
+            for (unsigned int lane = 0; lane < lanes; lane++) {
+                unsigned int v = vts.index(i + lane);
+                float w = vts.clip.w[v];
+                sx[lane] = vts.clip.x[v] / w * halfW + halfW;
+                sy[lane] = vts.clip.y[v] / w * halfH + halfH;
+                depth[lane] = vts.clip.z[v] / w;
+            }
+        }
+
+        // the square of pixels of a point, keeping the closest value of each pixel, and marking the tiles it changed
+        inline void splat(float sx, float sy, uint64_t value, int width, int height) {
+            int firstX = firstPixel(sx), firstY = firstPixel(sy);
+            int x0 = std::max(firstX, 0), x1 = std::min(firstX + m_pointSize, width) - 1;
+            int y0 = std::max(firstY, 0), y1 = std::min(firstY + m_pointSize, height) - 1;
+            for (int y = y0; y <= y1; y++)
+                for (int x = x0; x <= x1; x++) {
+                    std::atomic<uint64_t> &pixel = m_splats[y * width + x];
+                    uint64_t current = pixel.load(std::memory_order_relaxed);
+                    if (value >= current)
+                        continue;
+                    while (value < current && !pixel.compare_exchange_weak(current, value, std::memory_order_relaxed));
+                    // x and y are not negative, the divisions are shifts
+                    std::atomic<uint8_t> &touched = m_touched[unsigned(y) / TILE_SIZE * m_tilesX + unsigned(x) / TILE_SIZE];
+                    if (!touched.load(std::memory_order_relaxed))
+                        touched.store(1, std::memory_order_relaxed);
+                }
+        }
+
+        // depth in the high 32 bits, with the bits of the float flipped so that they sort as the float does,
+        // color in the low 32 bits
+        static inline uint64_t packSplat(float depth, uint32_t col) {
+            uint32_t bits;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+            return (uint64_t(bits) << 32) | col;
+        }
+        static inline float unpackDepth(uint64_t value) {
+            uint32_t bits = uint32_t(value >> 32);
+            bits = (bits & 0x80000000u) ? bits & 0x7fffffffu : ~bits;
+            float depth;
+            std::memcpy(&depth, &bits, sizeof(depth));
+            return depth;
         }
 
         // list of point primitives.
-        std::vector<point> m_primitives;
+        ArenaVector<point<Vertex> > m_primitives;
+
+        // depth and color of each pixel of the point cloud path, see packSplat
+        std::unique_ptr<std::atomic<uint64_t>[]> m_splats;
+        unsigned int m_splatSize = 0;
+        // screen tiles with pixels replaced by a point
+        std::unique_ptr<std::atomic<uint8_t>[]> m_touched;
+        unsigned int m_tileCount = 0;
+        int m_tilesX = 0;
     };
+
+    typedef BasicPointRenderer<ColorShader> PointRenderer;
 };
 
 #endif //GRAPHICSPROGRAMMINGEXERCISES_OGLPOINTRENDERER_H
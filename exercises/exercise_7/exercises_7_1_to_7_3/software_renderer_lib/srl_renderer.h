@@ -7,89 +7,384 @@
 
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
+#include <type_traits>
 #include "glm/glm.hpp"
 #include "srl_frame_buffer.h"
 #include "srl_types.h"
+#include "srl_clip_space.h"
+#include "srl_bounds.h"
+#include "srl_frame_capture.h"
+#include "srl_pipeline_stats.h"
+#include "srl_shader.h"
 
 namespace srl {
 
-    class Renderer {
+    // fragment outputs of the rasterization. For each fragment the rasterizer calls test(x, y, depth) and,
+    // only if it returns true, computes the color and calls write(x, y, depth, color)
+
+    // keeps the fragments in a list, they are written to the frame buffer in a second pass
+    struct FragmentList {
+        ArenaVector<fragment> &frs;
+
+        inline bool test(int, int, float) const { return true; }
+
+        inline void write(int posX, int posY, float depth, const color &col) {
+            fragment frag;
+            frag.posX = posX;
+            frag.posY = posY;
+            frag.depth = depth;
+            frag.col = col;
+            frs.push_back(frag);
+        }
+    };
+
+    // what a rendering pass writes to the frame buffer. A z-prepass draws the scene DepthOnly and then again with
+    // EqualDepth, so that each pixel is shaded once, by the closest fragment, no matter the overdraw
+    enum class PassMode {
+        Color,      // the color and depth of the fragments closer than the depth buffer
+        DepthOnly,  // only the depth of the fragments closer than the depth buffer, nothing is shaded
+        EqualDepth  // only the color of the fragments at the depth already in the depth buffer
+    };
+
+    // depth tests and writes the fragments straight to the frame buffer, in a single pass. Addressing is the
+    // addressing of the layout of fb and db (see FrameBuffer::withAddressing), use withFrameBufferWriter to get one.
+    // Mode is what is tested and written, fb is nullptr for DepthOnly
+    template<class Addressing, PassMode Mode = PassMode::Color>
+    struct FrameBufferWriter {
+        FrameBuffer <uint32_t> *fb;
+        FrameBuffer <float> &db;
+        Addressing addressing;
+        // index of the last fragment that passed the test
+        unsigned int index = 0;
+        // the outcome of the depth tests is added to stats when the writer goes out of scope
+        PipelineStats *stats;
+        SRL_STATS(uint64_t depthFailed = 0; uint64_t written = 0;)
+
+        FrameBufferWriter(FrameBuffer <uint32_t> *fb, FrameBuffer <float> &db, const Addressing &addressing, PipelineStats *stats = nullptr)
+            : fb(fb), db(db), addressing(addressing), stats(stats) {}
+
+        ~FrameBufferWriter() {
+            SRL_STATS(if (stats) { stats->fragmentsDepthFailed += depthFailed; stats->fragmentsWritten += written; })
+        }
+
+        inline bool test(int posX, int posY, float depth) {
+            // make sure it is within framebuffer range (it won't be if we do not clip)
+            if (posX < 0 || posX >= (int) db.width() || posY < 0 || posY >= (int) db.height()) {
+                SRL_STATS(depthFailed++;)
+                return false;
+            }
+            // a tile of db pending a (fast) clear is filled with the clear value the first time we read it
+            db.resolveAt(posX, posY);
+            index = addressing.index(posX, posY);
+            bool passed = Mode == PassMode::EqualDepth ? depth == db[index] : depth < db[index];
+            SRL_STATS(depthFailed += !passed;)
+            return passed;
+        }
+
+        // must follow a call to test that returned true
+        inline void write(int posX, int posY, float depth, const color &col) {
+            write(posX, posY, depth, col.getRGBA32());
+        }
+
+        // write value as it is, e.g. the triangle ids of a visibility buffer
+        inline void write(int posX, int posY, float depth, uint32_t value) {
+            if (Mode != PassMode::DepthOnly) {
+                fb->resolveAt(posX, posY);
+                (*fb)[index] = value;
+            }
+            if (Mode != PassMode::EqualDepth)
+                db[index] = depth;
+            SRL_STATS(written++;)
+        }
+    };
+
+    // call f(writer) with a FrameBufferWriter for the layout of fb and db, which must be the same. The layout
+    // is tested once here, instead of once per fragment
+    template<PassMode Mode, class F>
+    void withFrameBufferWriter(FrameBuffer <uint32_t> *fb, FrameBuffer <float> &db, PipelineStats *stats, F &&f) {
+        db.withAddressing([&](const auto &addressing) {
+            FrameBufferWriter<typename std::decay<decltype(addressing)>::type, Mode> writer(fb, db, addressing, stats);
+            f(writer);
+        });
+    }
+    template<class F>
+    void withFrameBufferWriter(FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db, PipelineStats *stats, F &&f) {
+        withFrameBufferWriter<PassMode::Color>(&fb, db, stats, f);
+    }
+
+    // what primitive assembly reads: the output of the vertex stage (clip space positions and varyings), and
+    // the order in which to read it. Vertex i of the stream is vertex indices[i] of the vertex stage, or vertex i
+    // if there is no index buffer. With an index buffer each vertex is shaded once, no matter how many primitives share it.
+    // vertices is the input of the vertex stage, e.g. to tell meshes apart. inside is true when the bounds of
+    // the vertices are in the view volume (see BasicRenderer::m_cullObjects), so no primitive needs to be clipped
+    template<class Varyings>
+    struct VertexStream {
+        const ClipSpaceVertices &clip;
+        const ArenaVector<Varyings> &varyings;
+        const std::vector<unsigned int> *indices;
+        const std::vector<vertex> &vertices;
+        bool inside;
+
+        inline unsigned int size() const { return indices ? (unsigned int) indices->size() : clip.size(); }
+        inline unsigned int index(unsigned int i) const { return indices ? (*indices)[i] : i; }
+
+        // vertex i of the stream, with its clip space position
+        inline shaded_vertex<Varyings> operator[](unsigned int i) const {
+            unsigned int v = index(i);
+            return shaded_vertex<Varyings>(clip.position(v), varyings[v]);
+        }
+        // only the clip space position of vertex i, e.g. in depth only passes, where the varyings are not computed
+        inline glm::vec4 position(unsigned int i) const { return clip.position(index(i)); }
+        inline uint8_t outcode(unsigned int i) const { return clip.outcode[index(i)]; }
+    };
+
+    // the renderers are templates of the shader program (see srl_shader.h), Renderer is the one that
+    // interpolates the color of the vertices
+    template<class Shader>
+    class BasicRenderer {
 
     public:
 
+        typedef typename Shader::Varyings Varyings;
+        // the vertices that go through primitive assembly, clipping and rasterization
+        typedef shaded_vertex<Varyings> Vertex;
+
+        // the vertex and fragment shaders, set their uniforms before rendering
+        Shader m_shader;
+
+        // when true, the rasterizers store the shaded fragments in a list that goes through writeToFrameBuffer,
+        // as in the original pipeline. This costs a lot of memory traffic, so by default
+        // the fragments are depth tested and written straight to the frame buffer. Useful for debugging
+        bool m_materializeFragments = false;
+
+        // test the bounding box of the vertices (see Bounds) against the view volume of each instance before
+        // the vertex stage. Instances outside of it are skipped, and the primitives of the ones inside of it
+        // are not clipped. The box is computed once per render call (and shared by its instances), unless given
+        // with setBounds. Shaders that replace the position (see usesDefaultPosition) are never culled, their
+        // vertices might end up anywhere
+        bool m_cullObjects = true;
+
+        // bounds of the vertices of vts, used instead of computing them until clearBounds(vts) (so when the
+        // vertices move, give the new bounds). Useful for large meshes, or to cull with a coarser volume
+        void setBounds(const std::vector<vertex> &vts, const Bounds &bounds) { m_bounds.attach(&vts, bounds); }
+        void clearBounds(const std::vector<vertex> &vts) { m_bounds.detach(&vts); }
+
+        // when set, every render call is recorded in it, with the settings of the renderer (see FrameCapture)
+        FrameCapture *m_capture = nullptr;
+
+        // the settings recorded with each draw in a capture, and set back when it is replayed
+        virtual void saveState(RenderState &state) const {
+            state.materializeFragments = m_materializeFragments;
+            state.cullObjects = m_cullObjects;
+        }
+        virtual void loadState(const RenderState &state) {
+            m_materializeFragments = state.materializeFragments;
+            m_cullObjects = state.cullObjects;
+        }
+
+        // all the scratch data of the pipeline (clip space vertices, primitives, fragments, ...) is allocated
+        // in a frame arena, which is released at the end of the frame. Calling render without beginFrame
+        // makes each call its own frame
+        void beginFrame() {
+            m_arena.beginFrame();
+            SRL_STATS(m_stats.reset();)
+        }
+        void endFrame() {
+            processEndFrame();
+            m_arena.endFrame();
+        }
+        // e.g. highWaterMark() is the most scratch memory used in a single frame
+        const FrameArena &frameArena() const { return m_arena; }
+
+        // counters and timings of the current frame (or of the last render call, when not using beginFrame).
+        // Only recorded when compiled with SRL_PIPELINE_STATS, see PipelineStats::ENABLED
+        const PipelineStats &pipelineStats() const { return m_stats; }
+
         // render vertices with mvp transformation in the fb framebuffer
         virtual void render(const std::vector<vertex> &vts, const glm::mat4 &mvp, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
-            // will copy all vertices since vts is const
-            m_vts = vts;
-            // 1. our vertex shader
-            processVertices(mvp, m_vts);
+            renderStream(vts, nullptr, &mvp, 1, &fb, db);
+        }
 
-            // 2. the fixed part of the pipeline
-            processPrimitives(m_vts, fb.width(), fb.height(), m_frs);
+        // render the vertices vts[indices[0]], vts[indices[1]], ... with mvp transformation in the fb framebuffer
+        virtual void render(const std::vector<vertex> &vts, const std::vector<unsigned int> &indices, const glm::mat4 &mvp, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
+            renderStream(vts, &indices, &mvp, 1, &fb, db);
+        }
 
-            // 3. our fragment shader
-            processFragments(m_frs);
+        // render one copy (instance) of the vertices for each transformation in mvps, in the fb framebuffer.
+        // Same as calling render once per transformation, but the per call work (e.g. writing the fragment list
+        // to the frame buffer, or updating data derived from the depth buffer) is only done once
+        virtual void render(const std::vector<vertex> &vts, const std::vector<glm::mat4> &mvps, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
+            renderStream(vts, nullptr, mvps.data(), mvps.size(), &fb, db);
+        }
 
-            // 4. fragment operations and copy color to the frame buffer
-            writeToFrameBuffer(m_frs, fb, db);
+        // instanced rendering of the vertices vts[indices[0]], vts[indices[1]], ...
+        virtual void render(const std::vector<vertex> &vts, const std::vector<unsigned int> &indices, const std::vector<glm::mat4> &mvps, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
+            renderStream(vts, &indices, mvps.data(), mvps.size(), &fb, db);
+        }
+
+    protected:
+
+        // arena for the scratch data of subclasses, see FrameArena::prepare
+        FrameArena &arena() { return m_arena; }
+
+        // statistics subclasses record in processPrimitives
+        PipelineStats &stats() { return m_stats; }
+
+        // render only the depth of the vertices in db (e.g. a shadow map), see processDepthPrimitives
+        void renderDepthStream(const std::vector<vertex> &vts, const std::vector<unsigned int> *indices, const glm::mat4 *mvps, unsigned int instanceCount, FrameBuffer <float> &db) {
+            renderStream(vts, indices, mvps, instanceCount, nullptr, db);
         }
 
     private:
 
+        // fb is nullptr when only the depth is rendered
+        void renderStream(const std::vector<vertex> &vts, const std::vector<unsigned int> *indices, const glm::mat4 *mvps, unsigned int instanceCount, FrameBuffer <uint32_t> *fb, FrameBuffer <float> &db) {
+            // the writers address both buffers with the same index
+            if (fb && (fb->width() != db.width() || fb->height() != db.height() || fb->layout() != db.layout()))
+                throw std::runtime_error("srl::Renderer: the color and depth buffers must have the same size and layout");
+            bool depthOnly = !fb || depthOnlyPass();
+
+            if (m_capture) {
+                RenderState state;
+                saveState(state);
+                m_capture->recordDraw(state, vts, indices, mvps, instanceCount, !fb, db);
+            }
+
+            bool implicitFrame = !m_arena.inFrame();
+            if (implicitFrame)
+                beginFrame();
+            SRL_STATS(m_stats.drawCalls++; m_stats.instances += instanceCount; m_stats.pixels = db.width() * db.height();)
+
+            // scratch data of this call, allocated in the frame arena
+            m_arena.prepare(m_frs);
+            m_clip.prepare(m_arena);
+
+            m_arena.prepare(m_varyings);
+
+            // vts is only read, each instance overwrites the clip space positions and varyings of the previous one
+            VertexStream<Varyings> stream {m_clip, m_varyings, indices, vts, false};
+
+            bool cullObjects = m_cullObjects && usesDefaultPosition<Shader>::value;
+            const Bounds *bounds = cullObjects ? &m_bounds.bounds(vts) : nullptr;
+            unsigned int drawn = 0;
+
+            for (unsigned int instance = 0; instance < instanceCount; instance++) {
+                // 0. skip the instances that are out of view, before transforming their vertices
+                if (cullObjects) {
+                    Visibility visibility = bounds->visibility(mvps[instance]);
+                    if (visibility == Visibility::Outside) {
+                        SRL_STATS(m_stats.instancesCulled++;)
+                        continue;
+                    }
+                    stream.inside = visibility == Visibility::Inside;
+                    SRL_STATS(m_stats.instancesInside += stream.inside;)
+                }
+                drawn++;
+
+                // 1. our vertex shader, each vertex of vts is shaded once, the clip space positions
+                // go to m_clip and the varyings to m_varyings (left empty when only the depth is rendered),
+                // vts is left untouched
+                SRL_STATS(StageClock clock(m_stats));
+                processVertices(mvps[instance], vts, m_clip, m_varyings, !depthOnly);
+                SRL_STATS(m_stats.verticesIn += vts.size(); clock.lap(PipelineStats::VERTEX));
 
-        virtual void processPrimitives (const std::vector<vertex> &inVts, unsigned int width, unsigned int height, std::vector<fragment> &outFrs) = 0;
+                // 2. the fixed part of the pipeline
+                // (unless m_materializeFragments is set, the fragments go straight to the frame buffer,
+                // and the fragment list is left empty)
+                if (depthOnly)
+                    processDepthPrimitives(stream, db);
+                else
+                    processPrimitives(stream, *fb, db, m_frs);
+            }
 
+            // nothing was drawn, the buffers are untouched
+            if (!drawn) {
+                if (implicitFrame)
+                    endFrame();
+                return;
+            }
 
+            // 3. our fragment shader runs in the rasterization loops of processPrimitives, see srl_shader.h
 
-        // perform vertex operations in the vertex stream (i.e. the equivalent to a vertex shader)
-        void processVertices(const glm::mat4 &mvp, std::vector<vertex> &vInOut) {
-            for (auto &vtx : vInOut){
-                // this is the equivalent to a vertex shader
-                vertex v = vtx;
-                // transform position
-                v.pos = mvp * v.pos;
-                // copy color
-                v.col = v.col;
-                // save it in the list
-                vtx = v;
+            // 4. fragment operations and copy color to the frame buffer
+            if (!m_frs.empty()) {
+                SRL_STATS(StageClock clock(m_stats));
+                writeToFrameBuffer(m_frs, *fb, db);
+                SRL_STATS(clock.lap(PipelineStats::FRAGMENT));
             }
+
+            // let anything derived from the depth buffer know that it changed
+            db.markModified();
+            processDepthBufferWritten(db);
+
+            if (implicitFrame)
+                endFrame();
         }
 
-        // perform fragment operations in the fragment stream (i.e. fragment shader)
-        void processFragments(std::vector<fragment>& fInOut) {
-            // fragment shader - not necessary for now since we are not modifying the color
+        virtual void processPrimitives (const VertexStream<Varyings> &inVts, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db, ArenaVector<fragment> &outFrs) = 0;
 
+        // the fixed part of the pipeline when only the depth is written, without varyings (see VertexStream::position)
+        virtual void processDepthPrimitives (const VertexStream<Varyings> &inVts, FrameBuffer <float> &db) {
+            throw std::runtime_error("srl::Renderer: this renderer cannot render only the depth");
         }
 
-        // fragment operations and copy color to frame buffer
-        void writeToFrameBuffer(const std::vector<fragment> &frs, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
-			int width = fb.width();
-			int height = fb.height();
-            for (int i = 0, size = frs.size(); i < size; i++) {
-				int posX = frs[i].posX;
-				int posY = frs[i].posY;
-
-                // make sure it is within framebuffer range (it won't be if we do not clip)
-				if (posX < 0 || posX >= width || posY < 0 || posY >= height)
-					continue;
-
-				// get 1D index in the framebuffer
-				int index = db.indexAt(posX, posY);
-				
-				// blending test and z/depth-buffer will come here
-				// set the color of the pixel in the frame buffer
-				if (frs[i].depth < db[index]) {
-					fb[index] = frs[i].col.getRGBA32();
-					db[index] = frs[i].depth;
-				}
+        // true if render only writes the depth, in processDepthPrimitives
+        virtual bool depthOnlyPass() const { return false; }
+
+        // called at the end of render, after db was marked as modified
+        virtual void processDepthBufferWritten(FrameBuffer <float> &db) {}
+
+        // called at the end of the frame, before its scratch memory is released
+        virtual void processEndFrame() {}
+
+
+
+        // perform vertex operations in the vertex stream (i.e. the vertex shader)
+        void processVertices(const glm::mat4 &mvp, const std::vector<vertex> &vIn, ClipSpaceVertices &out, ArenaVector<Varyings> &varyings, bool shadeVaryings) {
+            // transform positions, several vertices at a time, unless the shader moves them itself
+            if (usesDefaultPosition<Shader>::value)
+                transformVertices(vIn, mvp, out);
+            else
+                shadePositions(vIn, [&](const vertex &v) { return m_shader.position(v, mvp); }, out);
+
+            if (!shadeVaryings) {
+                varyings.clear();
+                return;
             }
+            varyings.resize(vIn.size());
+            for (unsigned int i = 0, size = vIn.size(); i < size; i++)
+                varyings[i] = m_shader.shadeVertex(vIn[i], mvp);
+        }
+
+        // fragment operations and copy color to frame buffer
+        void writeToFrameBuffer(const ArenaVector<fragment> &frs, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db) {
+            withFrameBufferWriter(fb, db, &m_stats, [&](auto &writer) {
+                for (int i = 0, size = frs.size(); i < size; i++) {
+                    // blending test and z/depth-buffer will come here
+                    // set the color of the pixel in the frame buffer
+                    if (writer.test(frs[i].posX, frs[i].posY, frs[i].depth))
+                        writer.write(frs[i].posX, frs[i].posY, frs[i].depth, frs[i].col);
+                }
+            });
         }
 
-        // lists of vertices and fragments. These are here to keep the allocated memory.
-        std::vector<vertex> m_vts;
-        std::vector<fragment> m_frs;
+        // declared first, the arena must outlive the vectors using it
+        FrameArena m_arena;
+
+        // clip space positions, varyings and list of fragments. These are here to keep the allocated memory
+        // while the frame lasts.
+        ClipSpaceVertices m_clip;
+        ArenaVector<Varyings> m_varyings;
+        ArenaVector<fragment> m_frs;
+
+        PipelineStats m_stats;
+
+        BoundsTable m_bounds;
     };
 
+    typedef BasicRenderer<ColorShader> Renderer;
+
 }
 
 #endif //GRAPHICSPROGRAMMINGEXERCISES_RENDERER_H
@@ -0,0 +1,88 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLSHADER_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLSHADER_H
+
+#include <type_traits>
+#include "glm/glm.hpp"
+#include "srl_types.h"
+
+namespace srl {
+
+    // the programmable stages of the pipeline. The renderers are templates of a shader class (e.g.
+    // BasicTriangleRenderer<ColorShader>), so the shader calls are inlined in the loops of each stage. A shader has:
+    //   typedef ... Varyings;
+    //       outputs of the vertex shader, interpolated across the primitives (perspective correct). They need the
+    //       operators + and - between varyings, and * and / by a float, as color has
+    //   glm::vec4 position(const vertex &in, const glm::mat4 &mvp) const;
+    //       clip space position of the vertex, inherit it from ShaderBase to keep the default (mvp * in.pos)
+    //   Varyings shadeVertex(const vertex &in, const glm::mat4 &mvp) const;
+    //       the vertex shader, runs once per vertex of each instance
+    //   color shadeFragment(const Varyings &in) const;
+    //       the fragment shader, runs once per fragment that passes the depth test (or once per fragment
+    //       generated, when the renderer materializes the fragments)
+    //   static const bool DERIVATIVES = true;
+    //   color shadeFragment(const Varyings &in, const Varyings &ddx, const Varyings &ddy) const;
+    //       instead of the above, for fragment shaders that need the screen space derivatives of the varyings
+    //       (e.g. to select the mip level of a texture). Triangles compute them from their plane equations, points
+    //       and lines give zero derivatives
+    // Uniforms are members of the shader, set them in the m_shader of the renderer before calling render
+    struct ShaderBase {
+        // the default position, the renderer transforms four vertices at a time instead of calling it
+        inline glm::vec4 position(const vertex &in, const glm::mat4 &mvp) const { return mvp * in.pos; }
+    };
+
+    // true if S did not replace the position of ShaderBase
+    template<class S>
+    struct usesDefaultPosition : std::is_same<decltype(&S::position), decltype(&ShaderBase::position)> {};
+
+    // true if S sets DERIVATIVES, its fragment shader takes the derivatives of the varyings
+    template<class S, class = void>
+    struct usesDerivatives : std::false_type {};
+    template<class S>
+    struct usesDerivatives<S, typename std::enable_if<S::DERIVATIVES>::type> : std::true_type {};
+
+    // run the fragment shader of primitives without derivatives (points and lines)
+    template<class S>
+    inline color shadeFragment(const S &shader, const typename S::Varyings &in, std::false_type) {
+        return shader.shadeFragment(in);
+    }
+    template<class S>
+    inline color shadeFragment(const S &shader, const typename S::Varyings &in, std::true_type) {
+        typename S::Varyings zero = in - in;
+        return shader.shadeFragment(in, zero, zero);
+    }
+    template<class S>
+    inline color shadeFragment(const S &shader, const typename S::Varyings &in) {
+        return shadeFragment(shader, in, usesDerivatives<S>());
+    }
+
+    // the color of the vertices, interpolated across the primitives
+    struct ColorShader : ShaderBase {
+        typedef color Varyings;
+
+        inline Varyings shadeVertex(const vertex &in, const glm::mat4 &) const { return in.col; }
+
+        inline color shadeFragment(const Varyings &in) const { return in; }
+    };
+
+    // varyings of shaders that do not interpolate anything, the triangle renderer only interpolates the depth
+    struct NoVaryings {
+        friend NoVaryings operator/ (NoVaryings v, float){ return v; }
+        friend NoVaryings operator* (NoVaryings v, float){ return v; }
+        friend NoVaryings operator- (NoVaryings v, const NoVaryings &){ return v; }
+        friend NoVaryings operator+ (NoVaryings v, const NoVaryings &){ return v; }
+    };
+
+    // the same color for all the fragments, e.g. for depth only draws and debugging
+    struct FlatColorShader : ShaderBase {
+        typedef NoVaryings Varyings;
+
+        color m_color = color::white();
+
+        inline Varyings shadeVertex(const vertex &, const glm::mat4 &) const { return Varyings(); }
+
+        inline color shadeFragment(const Varyings &) const { return m_color; }
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLSHADER_H
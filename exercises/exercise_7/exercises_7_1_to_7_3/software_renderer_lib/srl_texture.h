@@ -0,0 +1,246 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLTEXTURE_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLTEXTURE_H
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "glm/glm.hpp"
+#include "srl_types.h"
+#include "srl_shader.h"
+#include "srl_frame_buffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#ifndef SRL_USE_SSE
+#define SRL_USE_SSE
+#endif
+#include <emmintrin.h>
+#endif
+
+namespace srl {
+
+    // how texels are read when sampling. The mip level is selected from the screen space derivatives of the
+    // texture coordinates, levels below 0 (magnification) read level 0
+    enum class TextureFilter {
+        Nearest,    // nearest texel of the nearest mip level
+        Bilinear,   // the 2x2 texels around the texture coordinates, in the nearest mip level
+        Trilinear   // bilinear in the two mip levels around the selected one, blended
+    };
+
+    // what texture coordinates outside of [0, 1] read
+    enum class TextureWrap {
+        Repeat,
+        Clamp
+    };
+
+    // RGBA texture with 8 bits per channel (as in color::getRGBA32) and a precomputed chain of mip levels, each one
+    // half the size of the previous one, down to 1x1. Minified textures read the level with about one texel per
+    // pixel, so that neighbouring pixels read neighbouring texels, instead of texels far apart in memory.
+    // The texels of each level are stored in 4x4 tiles (TiledAddressing, a tile is a 64 byte cache line), so the
+    // 2x2 texels of a bilinear sample usually share a cache line, whatever the orientation of the texture on screen.
+    // Texture coordinates (0, 0) and (1, 1) are the corners of the texture, v = 0 is its first row
+    class Texture {
+    public:
+
+        TextureFilter m_filter = TextureFilter::Trilinear;
+        TextureWrap m_wrap = TextureWrap::Repeat;
+
+        // width x height texels in row order, the mip levels are computed with a box filter, unless mipmaps is false
+        Texture(unsigned int width, unsigned int height, const uint32_t *texels, bool mipmaps = true);
+
+        // textures are large, move them instead
+        Texture(const Texture &) = delete;
+        Texture &operator=(const Texture &) = delete;
+        Texture(Texture &&) = default;
+        Texture &operator=(Texture &&) = default;
+
+        inline unsigned int levels() const { return (unsigned int) m_levels.size(); }
+        inline unsigned int width(unsigned int level = 0) const { return m_levels[level].width; }
+        inline unsigned int height(unsigned int level = 0) const { return m_levels[level].height; }
+
+        // texel (x, y) of a mip level, as stored
+        inline uint32_t texel(unsigned int level, unsigned int x, unsigned int y) const {
+            const Level &l = m_levels[level];
+            return m_texels[l.offset + l.addressing.index(x, y)];
+        }
+
+        // mip level with about one texel per pixel, from the screen space derivatives of the texture coordinates
+        inline float lod(const glm::vec2 &ddx, const glm::vec2 &ddy) const {
+            glm::vec2 size(m_levels[0].width, m_levels[0].height);
+            glm::vec2 dx = ddx * size, dy = ddy * size;
+            // log2 of the longest of the two footprints
+            float rho2 = std::max(glm::dot(dx, dx), glm::dot(dy, dy));
+            return rho2 > 0.f ? .5f * std::log2(rho2) : -128.f;
+        }
+
+        // sample the texture in mip level lod with m_filter and m_wrap
+        color sample(const glm::vec2 &uv, float lod) const;
+
+        // sample the texture, with the screen space derivatives of uv, e.g. in a fragment shader
+        inline color sample(const glm::vec2 &uv, const glm::vec2 &ddx, const glm::vec2 &ddy) const {
+            return sample(uv, lod(ddx, ddy));
+        }
+
+    private:
+
+        struct Level {
+            unsigned int width, height;
+            // position of the first texel of the level in m_texels
+            unsigned int offset;
+            TiledAddressing<4> addressing;
+        };
+
+        // wrap a texel coordinate into [0, size)
+        inline int wrap(int x, int size) const {
+            if (m_wrap == TextureWrap::Clamp)
+                return x < 0 ? 0 : (x >= size ? size - 1 : x);
+            // avoid the division with the usual power of two sizes
+            if ((size & (size - 1)) == 0)
+                return x & (size - 1);
+            x %= size;
+            return x < 0 ? x + size : x;
+        }
+        // wrap(x + 1, size), given wrapped = wrap(x, size)
+        inline int wrapNext(int x, int wrapped, int size) const {
+            if (m_wrap == TextureWrap::Clamp)
+                return wrap(x + 1, size);
+            return wrapped + 1 < size ? wrapped + 1 : 0;
+        }
+
+        color nearest(const Level &level, const glm::vec2 &uv) const;
+        color bilinear(const Level &level, const glm::vec2 &uv) const;
+
+        std::vector<Level> m_levels;
+        std::vector<uint32_t> m_texels;
+    };
+
+    inline Texture::Texture(unsigned int width, unsigned int height, const uint32_t *texels, bool mipmaps) {
+        if (width == 0 || height == 0)
+            throw std::runtime_error("srl::Texture: the texture must have at least one texel");
+
+        // sizes and positions of the levels, each one padded to a whole number of tiles
+        unsigned int size = 0;
+        for (unsigned int w = width, h = height; ; w = std::max(1u, w / 2), h = std::max(1u, h / 2)) {
+            TiledAddressing<4> addressing {(w + 3) / 4};
+            m_levels.push_back({w, h, size, addressing});
+            size += addressing.tilesX * ((h + 3) / 4) * 16;
+            if (!mipmaps || (w == 1 && h == 1))
+                break;
+        }
+        m_texels.resize(size, 0);
+
+        for (unsigned int y = 0; y < height; y++)
+            for (unsigned int x = 0; x < width; x++)
+                m_texels[m_levels[0].offset + m_levels[0].addressing.index(x, y)] = texels[y * width + x];
+
+        // each texel of a level is the average of 2x2 texels of the previous one (the last row or column of
+        // levels with an odd size is left out, as in most GPU drivers)
+        for (unsigned int l = 1; l < m_levels.size(); l++) {
+            const Level &src = m_levels[l - 1];
+            const Level &dst = m_levels[l];
+            for (unsigned int y = 0; y < dst.height; y++)
+                for (unsigned int x = 0; x < dst.width; x++) {
+                    unsigned int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+                    unsigned int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+                    uint32_t t[4] = {texel(l - 1, x0, y0), texel(l - 1, x1, y0), texel(l - 1, x0, y1), texel(l - 1, x1, y1)};
+                    uint32_t average = 0;
+                    for (int channel = 0; channel < 32; channel += 8) {
+                        uint32_t sum = 2; // round to nearest
+                        for (uint32_t value : t)
+                            sum += (value >> channel) & 0xffu;
+                        average |= (sum / 4) << channel;
+                    }
+                    m_texels[dst.offset + dst.addressing.index(x, y)] = average;
+                }
+        }
+    }
+
+    inline color Texture::sample(const glm::vec2 &uv, float lod) const {
+        unsigned int last = levels() - 1;
+        if (m_filter == TextureFilter::Trilinear && lod > 0.f && last > 0) {
+            float level = std::min(lod, float(last));
+            unsigned int l0 = std::min((unsigned int) level, last), l1 = std::min(l0 + 1, last);
+            float t = level - float(l0);
+            color c0 = bilinear(m_levels[l0], uv);
+            if (t == 0.f || l0 == l1)
+                return c0;
+            return c0 + (bilinear(m_levels[l1], uv) - c0) * t;
+        }
+
+        // nearest mip level
+        unsigned int l = lod > 0.f ? std::min((unsigned int) (lod + .5f), last) : 0;
+        return m_filter == TextureFilter::Nearest ? nearest(m_levels[l], uv) : bilinear(m_levels[l], uv);
+    }
+
+    inline color Texture::nearest(const Level &level, const glm::vec2 &uv) const {
+        int x = wrap(int(std::floor(uv.x * level.width)), level.width);
+        int y = wrap(int(std::floor(uv.y * level.height)), level.height);
+        uint32_t t = m_texels[level.offset + level.addressing.index(x, y)];
+        const float scale = 1.f / 255.f;
+        return {float(t & 0xffu) * scale, float((t >> 8) & 0xffu) * scale,
+                float((t >> 16) & 0xffu) * scale, float(t >> 24) * scale};
+    }
+
+    inline color Texture::bilinear(const Level &level, const glm::vec2 &uv) const {
+        // texel centers are at (i + .5) / size
+        float u = uv.x * level.width - .5f, v = uv.y * level.height - .5f;
+        float fu = std::floor(u), fv = std::floor(v);
+        float tu = u - fu, tv = v - fv;
+        int x0 = wrap(int(fu), level.width), x1 = wrapNext(int(fu), x0, level.width);
+        int y0 = wrap(int(fv), level.height), y1 = wrapNext(int(fv), y0, level.height);
+        const uint32_t *texels = m_texels.data() + level.offset;
+        uint32_t t00 = texels[level.addressing.index(x0, y0)], t10 = texels[level.addressing.index(x1, y0)];
+        uint32_t t01 = texels[level.addressing.index(x0, y1)], t11 = texels[level.addressing.index(x1, y1)];
+
+        float w00 = (1.f - tu) * (1.f - tv), w10 = tu * (1.f - tv), w01 = (1.f - tu) * tv, w11 = tu * tv;
+        const float scale = 1.f / 255.f;
+        color c;
+#ifdef SRL_USE_SSE
+        // the four channels of a texel in the four lanes of a register, blend all of them at once
+        __m128i zero = _mm_setzero_si128();
+        __m128i t0 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(t00)), zero), t1 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(t10)), zero);
+        __m128i t2 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(t01)), zero), t3 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(t11)), zero);
+        __m128 sum = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(t0, zero)), _mm_set1_ps(w00 * scale));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(t1, zero)), _mm_set1_ps(w10 * scale)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(t2, zero)), _mm_set1_ps(w01 * scale)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(t3, zero)), _mm_set1_ps(w11 * scale)));
+        _mm_storeu_ps(&c.r, sum);
+#else
+        float *channels = &c.r;
+        for (int channel = 0; channel < 4; channel++) {
+            int shift = channel * 8;
+            channels[channel] = (float((t00 >> shift) & 0xffu) * w00 + float((t10 >> shift) & 0xffu) * w10 +
+                                 float((t01 >> shift) & 0xffu) * w01 + float((t11 >> shift) & 0xffu) * w11) * scale;
+        }
+#endif
+        return c;
+    }
+
+
+    // a texture, with the texture coordinates of the vertices interpolated across the primitives.
+    // The mip level is selected with the derivatives of the texture coordinates
+    struct TextureShader : ShaderBase {
+        static const bool DERIVATIVES = true;
+
+        struct Varyings {
+            glm::vec2 uv;
+
+            friend Varyings operator/ (Varyings v, float sc){ v.uv /= sc; return v; }
+            friend Varyings operator* (Varyings v, float sc){ v.uv *= sc; return v; }
+            friend Varyings operator- (Varyings v1, const Varyings &v2){ v1.uv -= v2.uv; return v1; }
+            friend Varyings operator+ (Varyings v1, const Varyings &v2){ v1.uv += v2.uv; return v1; }
+        };
+
+        const Texture *m_texture = nullptr;
+
+        inline Varyings shadeVertex(const vertex &in, const glm::mat4 &) const { return {in.uv}; }
+
+        inline color shadeFragment(const Varyings &in, const Varyings &ddx, const Varyings &ddy) const {
+            return m_texture->sample(in.uv, ddx.uv, ddy.uv);
+        }
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLTEXTURE_H
@@ -0,0 +1,182 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLTHREADPOOL_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLTHREADPOOL_H
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace srl {
+
+    // a small work-stealing thread pool used to run independent pieces of the pipeline in parallel
+    // (e.g. screen tiles). Each call to parallelFor splits the task indices into one contiguous range
+    // per worker; a worker takes tasks from the front of its own range and, once it runs out of work,
+    // steals tasks from the back of the range of another worker.
+    class ThreadPool {
+    public:
+
+        // threadCount is the total number of workers, including the thread that calls parallelFor.
+        // 0 means one worker per hardware thread
+        explicit ThreadPool(unsigned int threadCount = 0) {
+            if (threadCount == 0)
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            m_queues = std::vector<WorkQueue>(threadCount);
+            // worker 0 is the thread calling parallelFor, so we only need to start threadCount-1 threads
+            for (unsigned int i = 1; i < threadCount; i++)
+                m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_quit = true;
+            }
+            m_wakeUp.notify_all();
+            for (auto &thread : m_threads)
+                thread.join();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // number of workers, including the calling thread
+        inline unsigned int size() const { return (unsigned int) m_queues.size(); }
+
+        // run task(index, worker) for every index in [0, count) and wait until all of them are done.
+        // worker is in [0, size()) and can be used to index per-worker data.
+        // calls to parallelFor are serialized, and a task must not call parallelFor itself
+        template<class Task>
+        void parallelFor(unsigned int count, const Task &task) {
+            if (count == 0)
+                return;
+
+            std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+            // run it in the calling thread if there is nothing to share
+            if (size() == 1 || count == 1) {
+                for (unsigned int i = 0; i < count; i++)
+                    task(i, 0);
+                return;
+            }
+
+            // type erased job, avoids allocating a std::function for every call
+            m_jobContext = &task;
+            m_jobFunction = [](const void *context, unsigned int index, unsigned int worker) {
+                (*static_cast<const Task *>(context))(index, worker);
+            };
+            m_pending = count;
+
+            // split the indices in one contiguous range per worker
+            unsigned int workers = size();
+            for (unsigned int w = 0; w < workers; w++) {
+                std::lock_guard<std::mutex> lock(m_queues[w].mutex);
+                m_queues[w].begin = (unsigned int)((unsigned long long) count * w / workers);
+                m_queues[w].end = (unsigned int)((unsigned long long) count * (w + 1) / workers);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_generation++;
+            }
+            m_wakeUp.notify_all();
+
+            // the calling thread works as worker 0
+            runTasks(0);
+
+            // wait for the tasks that were taken by other workers
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_pending.load() == 0 && m_busyWorkers == 0; });
+        }
+
+        // pool shared by all renderers, with one worker per hardware thread
+        static ThreadPool &shared() {
+            static ThreadPool pool;
+            return pool;
+        }
+
+    private:
+
+        struct WorkQueue {
+            std::mutex mutex;
+            unsigned int begin = 0;
+            unsigned int end = 0;
+        };
+
+        void workerLoop(unsigned int worker) {
+            unsigned long long seenGeneration = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wakeUp.wait(lock, [&]() { return m_quit || m_generation != seenGeneration; });
+                    if (m_quit)
+                        return;
+                    seenGeneration = m_generation;
+                    m_busyWorkers++;
+                }
+
+                runTasks(worker);
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_busyWorkers--;
+                }
+                m_done.notify_all();
+            }
+        }
+
+        // execute tasks until there is nothing left in any queue
+        void runTasks(unsigned int worker) {
+            unsigned int index;
+            while (popTask(worker, index) || stealTask(worker, index)) {
+                m_jobFunction(m_jobContext, index, worker);
+                if (--m_pending == 0)
+                    m_done.notify_all();
+            }
+        }
+
+        // take the next task from the front of our own range
+        bool popTask(unsigned int worker, unsigned int &index) {
+            WorkQueue &queue = m_queues[worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.begin == queue.end)
+                return false;
+            index = queue.begin++;
+            return true;
+        }
+
+        // take a task from the back of the range of another worker
+        bool stealTask(unsigned int worker, unsigned int &index) {
+            for (unsigned int i = 1, workers = size(); i < workers; i++) {
+                WorkQueue &queue = m_queues[(worker + i) % workers];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.begin != queue.end) {
+                    index = --queue.end;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::vector<WorkQueue> m_queues;
+        std::vector<std::thread> m_threads;
+
+        // current job
+        const void *m_jobContext = nullptr;
+        void (*m_jobFunction)(const void *, unsigned int, unsigned int) = nullptr;
+        std::atomic<unsigned int> m_pending {0};
+
+        // synchronization between the calling thread and the workers
+        std::mutex m_submitMutex;
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_done;
+        unsigned long long m_generation = 0;
+        unsigned int m_busyWorkers = 0;
+        bool m_quit = false;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLTHREADPOOL_H
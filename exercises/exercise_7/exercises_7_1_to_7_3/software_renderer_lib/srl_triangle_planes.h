@@ -0,0 +1,136 @@
+#ifndef GRAPHICSPROGRAMMINGEXERCISES_OGLTRIANGLEPLANES_H
+#define GRAPHICSPROGRAMMINGEXERCISES_OGLTRIANGLEPLANES_H
+
+#include <type_traits>
+#include "srl_types.h"
+
+namespace srl {
+
+    // an attribute of a triangle as a function of the pixel position, a(x, y) = (origin + dy * y) + dx * x, with
+    // x and y relative to the third vertex. T is float or the varyings of a shader
+    template<class T>
+    struct AttributePlane {
+        T origin, dx, dy;
+
+        // plane through the values a1, a2 and a3 of the vertices, (x1, y1) and (x2, y2) are the positions of the
+        // first and second vertices relative to the third, and invDet is one over x1 * y2 - x2 * y1
+        void setup(const T &a1, const T &a2, const T &a3, float x1, float y1, float x2, float y2, float invDet) {
+            T da1 = a1 - a3, da2 = a2 - a3;
+            origin = a3;
+            dx = (da1 * y2 - da2 * y1) * invDet;
+            dy = (da2 * x1 - da1 * x2) * invDet;
+        }
+
+        // the value at the start (x = 0) of row y, the rows add dx * x to it
+        inline T row(float y) const { return origin + dy * y; }
+    };
+
+    // the attributes of a triangle in screen space (after divideByW, so pos.z is the depth and var and one are
+    // divided by w) as planes, computed once per triangle. Each fragment evaluates only what it needs: the depth
+    // for the depth test, and the varyings if the fragment passes it. The varyings are perspective correct,
+    // divided by the interpolated 1/w. Shaders without varyings (e.g. FlatColorShader) only interpolate the depth.
+    // The planes go through the vertices snapped to the pixel grid, like in the rasterizers.
+    // The rasterizers generate runs of pixels of a row, so the planes are evaluated per row (see Row)
+    template<class Varyings>
+    class TrianglePlanes {
+    public:
+
+        // the planes in row y, each pixel costs a multiply and an add per attribute. Keeps a copy of what it
+        // needs, so that writing the buffers does not make the compiler read the planes again for every pixel
+        class Row {
+        public:
+            Row(const TrianglePlanes &planes, int y) : m_planes(&planes), m_x3(planes.m_x3) {
+                float fy = float(y) - planes.m_y3;
+                m_depth.start = planes.m_depth.row(fy);
+                m_depth.dx = planes.m_depth.dx;
+                setupVaryings(planes, fy, std::is_empty<Varyings>());
+            }
+
+            // depth of pixel x of the row
+            inline float depth(int x) const { return m_depth.at(float(x) - m_x3); }
+
+            // perspective correct varyings of pixel x of the row
+            inline Varyings varyings(int x) const {
+                return interpolateVaryings(float(x) - m_x3, std::is_empty<Varyings>());
+            }
+
+            // perspective correct varyings of pixel x of the row and their screen space derivatives. The varyings
+            // are v = p / q, with p the plane of var / w and q the plane of 1 / w, so dv/dx = (dp/dx - v * dq/dx) / q
+            inline Varyings varyings(int x, Varyings &ddx, Varyings &ddy) const {
+                if (std::is_empty<Varyings>::value)
+                    return ddx = ddy = Varyings();
+                float fx = float(x) - m_x3;
+                float invOne = 1.f / m_one.at(fx);
+                Varyings v = m_varyings.at(fx) * invOne;
+                ddx = (m_planes->m_varyings.dx - v * m_planes->m_one.dx) * invOne;
+                ddy = (m_planes->m_varyings.dy - v * m_planes->m_one.dy) * invOne;
+                return v;
+            }
+
+        private:
+            template<class T>
+            struct Line {
+                T start, dx;
+                inline T at(float x) const { return start + dx * x; }
+            };
+
+            void setupVaryings(const TrianglePlanes &planes, float fy, std::false_type) {
+                m_one.start = planes.m_one.row(fy);
+                m_one.dx = planes.m_one.dx;
+                m_varyings.start = planes.m_varyings.row(fy);
+                m_varyings.dx = planes.m_varyings.dx;
+            }
+            void setupVaryings(const TrianglePlanes &, float, std::true_type) {}
+
+            inline Varyings interpolateVaryings(float fx, std::false_type) const {
+                // hyperbolic interpolation
+                return m_varyings.at(fx) * (1.f / m_one.at(fx));
+            }
+            inline Varyings interpolateVaryings(float, std::true_type) const { return Varyings(); }
+
+            // the derivatives read the y gradients from the planes
+            const TrianglePlanes *m_planes;
+            float m_x3;
+            Line<float> m_depth, m_one;
+            Line<Varyings> m_varyings;
+        };
+
+        // Vertex is shaded_vertex<Varyings>, or any shaded_vertex if Varyings is empty (only the depth is interpolated)
+        template<class Vertex>
+        TrianglePlanes(const Vertex &v1, const Vertex &v2, const Vertex &v3) {
+            m_x3 = float(int(v3.pos.x + .5f));
+            m_y3 = float(int(v3.pos.y + .5f));
+            float x1 = float(int(v1.pos.x + .5f)) - m_x3, y1 = float(int(v1.pos.y + .5f)) - m_y3;
+            float x2 = float(int(v2.pos.x + .5f)) - m_x3, y2 = float(int(v2.pos.y + .5f)) - m_y3;
+            // the rasterizers do not generate pixels for triangles with no area, any value will do
+            float det = x1 * y2 - x2 * y1;
+            float invDet = det != 0.f ? 1.f / det : 0.f;
+
+            m_depth.setup(v1.pos.z, v2.pos.z, v3.pos.z, x1, y1, x2, y2, invDet);
+            setupVaryings(v1, v2, v3, x1, y1, x2, y2, invDet, std::is_empty<Varyings>());
+        }
+
+        inline Row row(int y) const { return Row(*this, y); }
+
+    private:
+
+        template<class Vertex>
+        void setupVaryings(const Vertex &v1, const Vertex &v2, const Vertex &v3,
+                           float x1, float y1, float x2, float y2, float invDet, std::false_type) {
+            m_one.setup(v1.one, v2.one, v3.one, x1, y1, x2, y2, invDet);
+            m_varyings.setup(v1.var, v2.var, v3.var, x1, y1, x2, y2, invDet);
+        }
+        template<class Vertex>
+        void setupVaryings(const Vertex &, const Vertex &, const Vertex &, float, float, float, float, float, std::true_type) {}
+
+        // position of the third vertex, the origin of the planes
+        float m_x3, m_y3;
+
+        AttributePlane<float> m_depth;
+        AttributePlane<float> m_one;
+        AttributePlane<Varyings> m_varyings;
+    };
+
+}
+
+#endif //GRAPHICSPROGRAMMINGEXERCISES_OGLTRIANGLEPLANES_H
@@ -6,57 +6,351 @@
 #define GRAPHICSPROGRAMMINGEXERCISES_OGLTRIANGLERENDERER_H
 
 #include <algorithm>
+#include <memory>
+#include <cstdint>
+#include "srl_renderer.h"
+#include "srl_thread_pool.h"
+#include "srl_depth_pyramid.h"
+#include "srl_triangle_planes.h"
 #include "rasterizer/trianglerasterizer.h"
+#include "rasterizer/halfspacerasterizer.h"
 
 namespace srl {
 
-    class TriangleRenderer : public Renderer {
+    template<class Shader>
+    class BasicTriangleRenderer : public BasicRenderer<Shader> {
     public:
+        typedef BasicRenderer<Shader> Base;
+        using typename Base::Varyings;
+        using typename Base::Vertex;
+        using Base::m_shader;
+        using Base::m_materializeFragments;
+
         bool m_clipToFrustum = true;
         bool m_cullBackFaces = true;
+        // triangles are only clipped in x and y if they go past a guard band this many times larger than
+        // the view volume, the rest of them is left to the rasterizer, which only visits the pixels in the screen.
+        // Near and far are always clipped
+        float m_guardBand = 8.f;
+        // sort the triangles into screen tiles and rasterize the tiles in parallel,
+        // draws that materialize their fragments are not binned
+        bool m_binned = false;
+
+        // algorithm used to rasterize the triangles, scanlines (triangle_rasterizer) or
+        // blocks of pixels tested against the edge functions (halfspace_rasterizer)
+        enum class RasterMode { Scanline, HalfSpace };
+        RasterMode m_rasterMode = RasterMode::Scanline;
+
+        // keep a min/max depth pyramid of the depth buffer, and skip the triangles (and, with the half-space
+        // rasterizer, the blocks of pixels) that are behind everything already drawn in the area they cover
+        bool m_hierarchicalZ = false;
+
+        // visibility buffer: the rasterization only writes the depth and the id of the triangle in each pixel, and each
+        // pixel is shaded once, at the end of the frame (endFrame, or the end of render when it is called outside of
+        // beginFrame/endFrame). So the cost of shading does not grow with overdraw. The shader of each draw call is
+        // kept until then. Draw calls of a frame with another color buffer, or without the visibility buffer, shade
+        // what is pending first. m_materializeFragments is ignored
+        bool m_visibilityBuffer = false;
+
+        // what render writes (see PassMode). A z-prepass renders the scene with DepthOnly, and then again with
+        // EqualDepth: the second pass only shades the fragments that ended up in front, so each pixel is shaded
+        // once. Both passes interpolate the depth in the same way, so the depths match exactly (the draws must be
+        // the same, with the same transformations). Where fragments of several triangles have exactly the same
+        // depth, the last one drawn is kept instead of the first. DepthOnly does not compute the varyings, nor
+        // touch the color buffer. m_materializeFragments only applies to Color
+        PassMode m_passMode = PassMode::Color;
+
+        // size of the (square) screen tiles used by the binned rasterization. A 64x64 tile of color and
+        // depth is 32KB, so the tile we are working on stays in the L1/L2 cache of the core rasterizing it
+        static const int TILE_SIZE = 64;
+
+        static_assert(int(RasterMode::HalfSpace) + 1 == RenderState::RASTER_MODES, "RenderState::RASTER_MODES is out of date");
+        static_assert(int(PassMode::EqualDepth) + 1 == RenderState::PASS_MODES, "RenderState::PASS_MODES is out of date");
+
+        void saveState(RenderState &state) const override {
+            Base::saveState(state);
+            state.type = RendererType::Triangles;
+            state.clipToFrustum = m_clipToFrustum;
+            state.cullBackFaces = m_cullBackFaces;
+            state.guardBand = m_guardBand;
+            state.binned = m_binned;
+            state.rasterMode = uint8_t(m_rasterMode);
+            state.hierarchicalZ = m_hierarchicalZ;
+            state.visibilityBuffer = m_visibilityBuffer;
+            state.passMode = uint8_t(m_passMode);
+        }
+        void loadState(const RenderState &state) override {
+            Base::loadState(state);
+            m_clipToFrustum = state.clipToFrustum;
+            m_cullBackFaces = state.cullBackFaces;
+            m_guardBand = state.guardBand;
+            m_binned = state.binned;
+            m_rasterMode = RasterMode(state.rasterMode);
+            m_hierarchicalZ = state.hierarchicalZ;
+            m_visibilityBuffer = state.visibilityBuffer;
+            m_passMode = PassMode(state.passMode);
+        }
+
+        // render only the depth of the vertices in db, as in the DepthOnly pass mode but without a color buffer
+        // (e.g. shadow maps)
+        void renderDepth(const std::vector<vertex> &vts, const glm::mat4 &mvp, FrameBuffer <float> &db) {
+            this->renderDepthStream(vts, nullptr, &mvp, 1, db);
+        }
+        void renderDepth(const std::vector<vertex> &vts, const std::vector<unsigned int> &indices, const glm::mat4 &mvp, FrameBuffer <float> &db) {
+            this->renderDepthStream(vts, &indices, &mvp, 1, db);
+        }
+
+        // occlusion query: the number of pixels of the box bounds, transformed by mvp, that would pass the depth
+        // test against db, counting at most maxSamples (1 is enough to know if anything in the box can be seen).
+        // Drawing an object only if its box passes skips the objects hidden behind what was already drawn.
+        // The test is conservative, it never finds hidden what could be seen: the silhouette of the box is grown
+        // by a pixel (the rasterizers snap the vertices to the pixel grid), and all of it is tested at the depth of
+        // the nearest corner, so only the coverage is rasterized and nothing is interpolated. A box that crosses
+        // the near plane, or goes past the guard band, is tested in the whole screen at the near plane
+        uint64_t occlusionQuery(const Bounds &bounds, const glm::mat4 &mvp, const FrameBuffer <float> &db,
+                                uint64_t maxSamples = UINT64_MAX) {
+            int width = db.width(), height = db.height();
+            if(maxSamples == 0 || bounds.visibility(mvp) == Visibility::Outside)
+                return 0;
+
+            // the corners in window coordinates, corner i has the max x if bit 0 is set, max y if bit 1, max z if bit 2
+            glm::vec4 corners[8];
+            bool wholeScreen = false;
+            float nearest = 1.f;
+            for(int i = 0; i < 8; i++) {
+                glm::vec4 pos = mvp * glm::vec4(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y,
+                                                i & 4 ? bounds.max.z : bounds.min.z, 1.f);
+                float band = m_guardBand * pos.w;
+                if(pos.z < -pos.w || pos.w <= 0.f || pos.x < -band || pos.x > band || pos.y < -band || pos.y > band) {
+                    wholeScreen = true;
+                    break;
+                }
+                pos /= pos.w;
+                corners[i] = toWindowSpace(pos, width / 2.f, height / 2.f);
+                nearest = std::min(nearest, pos.z);
+            }
+
+            // the rows of the silhouette, the projection of a box is convex so each row is a single run of pixels
+            m_queryRows.resize(2 * height);
+            int *rowBegin = m_queryRows.data(), *rowEnd = rowBegin + height;
+            std::fill(rowBegin, rowEnd, width);
+            std::fill(rowEnd, rowEnd + height, -1);
+            auto addSpan = [&](int y, int xBegin, int xEnd) {
+                rowBegin[y] = std::min(rowBegin[y], xBegin);
+                rowEnd[y] = std::max(rowEnd[y], xEnd);
+            };
+            int y0 = height, y1 = -1;
+            if(wholeScreen) {
+                nearest = -1.f;
+                y0 = 0; y1 = height - 1;
+                for(int y = 0; y < height; y++)
+                    addSpan(y, 0, width - 1);
+            }
+            else {
+                // the faces of the box, two triangles each. Only the coverage is needed, so they always go through the
+                // scanline rasterizer (the half-space one would skip the blocks behind the hierarchical z-buffer)
+                static const int faces[6][4] = {{0, 1, 3, 2}, {4, 5, 7, 6}, {0, 1, 5, 4}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 3, 7, 5}};
+                for(const int *face : faces)
+                    for(int half = 0; half < 2; half++) {
+                        triangle_rasterizer rasterizer(corners[face[0]], corners[face[half + 1]], corners[face[half + 2]],
+                                                       0, 0, width - 1, height - 1);
+                        while (rasterizer.more_fragments()) {
+                            addSpan(rasterizer.y(), rasterizer.x(), rasterizer.x_end());
+                            rasterizer.next_span();
+                        }
+                    }
+                // the pixels of the corners, moved into the screen, so that a box that covers no pixel center
+                // (or only pixels just outside of the screen) is still tested
+                for(const glm::vec4 &corner : corners) {
+                    int x = std::min(std::max(int(corner.x + .5f), 0), width - 1);
+                    int y = std::min(std::max(int(corner.y + .5f), 0), height - 1);
+                    addSpan(y, x, x);
+                }
+                for(int y = 0; y < height; y++)
+                    if(rowBegin[y] <= rowEnd[y]) {
+                        y0 = std::min(y0, y);
+                        y1 = y;
+                    }
+                // interpolating in float may give fragments a bit closer than the nearest vertex (see hiddenByHiZ)
+                nearest -= 1e-5f;
+            }
+
+            // grow the silhouette by a pixel: each row also covers the runs of the rows above and below
+            int x0 = width, x1 = -1;
+            int previousBegin = width, previousEnd = -1;
+            for(int y = std::max(y0 - 1, 0), last = std::min(y1 + 1, height - 1); y <= last; y++) {
+                int begin = std::min(previousBegin, rowBegin[y]), end = std::max(previousEnd, rowEnd[y]);
+                if(y < height - 1) {
+                    begin = std::min(begin, rowBegin[y + 1]);
+                    end = std::max(end, rowEnd[y + 1]);
+                }
+                previousBegin = rowBegin[y]; previousEnd = rowEnd[y];
+                rowBegin[y] = std::max(begin - 1, 0);
+                rowEnd[y] = std::min(end + 1, width - 1);
+                x0 = std::min(x0, rowBegin[y]);
+                x1 = std::max(x1, rowEnd[y]);
+            }
+            y0 = std::max(y0 - 1, 0);
+            y1 = std::min(y1 + 1, height - 1);
+
+            // the whole silhouette is behind the depth buffer
+            if(m_hierarchicalZ) {
+                m_hiZ.sync(db);
+                if(m_hiZ.occluded(x0, y0, x1, y1, nearest))
+                    return 0;
+            }
+
+            uint64_t samples = 0;
+            m_queryDepths.resize(width);
+            for(int y = y0; y <= y1; y++) {
+                db.loadRect(rowBegin[y], y, rowEnd[y], y, m_queryDepths.data(), width);
+                for(int x = 0, count = rowEnd[y] - rowBegin[y] + 1; x < count; x++)
+                    samples += nearest < m_queryDepths[x];
+                if(samples >= maxSamples)
+                    return maxSamples;
+            }
+            return samples;
+        }
 
     private:
+        using Base::arena;
+        using Base::stats;
+
+        // planes of the attributes of a triangle, and of only its depth
+        typedef TrianglePlanes<Varyings> Planes;
+        typedef TrianglePlanes<NoVaryings> DepthPlanes;
+
+        void processPrimitives (const VertexStream<Varyings> &inVts, FrameBuffer <uint32_t> &fb, FrameBuffer <float> &db, ArenaVector<fragment> &outFrs) override{
+            setupPrimitives(inVts, db, true);
+
+            // 2.6. rasterization (generate fragments)
+            if(m_passMode == PassMode::EqualDepth)
+                rasterize<PassMode::EqualDepth>(&fb, db, &outFrs);
+            else
+                rasterize<PassMode::Color>(&fb, db, &outFrs);
+        }
+
+        void processDepthPrimitives (const VertexStream<Varyings> &inVts, FrameBuffer <float> &db) override{
+            setupPrimitives(inVts, db, false);
+            rasterize<PassMode::DepthOnly>(nullptr, db, nullptr);
+        }
+
+        bool depthOnlyPass() const override { return m_passMode == PassMode::DepthOnly; }
+
+        // 2.1. to 2.5. the primitives of the stream, in screen space and ready to be rasterized. Without varyings
+        // (depth only passes) the vertices only have their position
+        void setupPrimitives(const VertexStream<Varyings> &inVts, const FrameBuffer <float> &db, bool varyings) {
+            SRL_STATS(StageClock clock(stats()));
+
+            // bring the depth pyramid up to date, in case db was cleared or written by someone else
+            if(m_hierarchicalZ) m_hiZ.sync(db);
+            SRL_STATS(clock.lap(PipelineStats::RASTERIZATION));
 
-        void processPrimitives (const std::vector<vertex> &inVts, unsigned int width, unsigned int height, std::vector<fragment> &outFrs) override{
             // 2.1. create the primitives
-            assemblePrimitives(inVts);
+            assemblePrimitives(inVts, varyings);
+            SRL_STATS(stats().primitivesAssembled += m_primitives.size(); clock.lap(PipelineStats::ASSEMBLY));
 
-            // 2.2. keep primitives in the visible volume
-            if(m_clipToFrustum) clipPrimitives();
+            // 2.5. reject the primitives that cannot produce fragments while still in clip space, so that they are
+            // not clipped, divided or rasterized
+            cullPrimitives(inVts, db.width(), db.height());
+            SRL_STATS(clock.lap(PipelineStats::SETUP));
 
-            // NEW!
-            // scale down the primitives so that the clipping is visible in the screen space
-            // TODO can be removed once clipping is working
-            glm::mat4 scale = glm::scale(0.75f, 0.75f, 0.75f);
-            for (auto & tri : m_primitives) {
-                tri.v1.pos = scale * tri.v1.pos;
-                tri.v2.pos = scale * tri.v2.pos;
-                tri.v3.pos = scale * tri.v3.pos;
-            }
+            // 2.2. keep primitives in the visible volume
+            if(m_clipToFrustum && !inVts.inside) clipPrimitives(inVts);
+            SRL_STATS(clock.lap(PipelineStats::CLIPPING));
 
             // 2.3. move vertices to normalized device coordinates
             divideByW();
 
             // 2.4. normalized device coordinates to screen space
-            toScreenSpace(width, height);
+            toScreenSpace(db.width(), db.height());
+            SRL_STATS(clock.lap(PipelineStats::SETUP));
+        }
 
-            // 2.5. reject primitives that are not facing towards the camera
-            if(m_cullBackFaces) backfaceCulling();
+        // 2.6. rasterization, Mode is what is tested and written (fb and outFrs are nullptr for DepthOnly)
+        template<PassMode Mode>
+        void rasterize(FrameBuffer <uint32_t> *fb, FrameBuffer <float> &db, ArenaVector<fragment> *outFrs) {
+            SRL_STATS(StageClock clock(stats()));
+            int width = db.width(), height = db.height();
+
+            if(Mode == PassMode::DepthOnly) {
+                // only the depth is interpolated, nothing is shaded
+                auto none = [](const typename DepthPlanes::Row &, int, unsigned int) { return 0u; };
+                if(m_binned) {
+                    binPrimitives(width, height);
+                    rasterBins<DepthPlanes, Mode>(nullptr, db, none);
+                }
+                else {
+                    withFrameBufferWriter<Mode>(nullptr, db, &stats(), [&](auto &output) { rasterPrimitives<DepthPlanes>(width, height, output, none); });
+                }
+                SRL_STATS(clock.lap(PipelineStats::RASTERIZATION));
+                return;
+            }
 
-            // 2.6. rasterization (generate fragments)
-            rasterPrimitives(outFrs);
+            if(m_visibilityBuffer) {
+                // only the depth and the id of the triangles, they are shaded at the end of the frame
+                unsigned int firstId = beginVisibility(*fb);
+                auto id = [&](const typename DepthPlanes::Row &, int, unsigned int i) { return firstId + i; };
+                if(m_binned) {
+                    binPrimitives(width, height);
+                    rasterBins<DepthPlanes, Mode>(m_visibility.get(), db, id);
+                }
+                else {
+                    withFrameBufferWriter<Mode>(m_visibility.get(), db, &stats(), [&](auto &output) { rasterPrimitives<DepthPlanes>(width, height, output, id); });
+                }
+                SRL_STATS(clock.lap(PipelineStats::RASTERIZATION));
+                return;
+            }
+
+            // draws of this frame that are waiting to be shaded go first
+            if(m_visibilityTarget)
+                resolveVisibility();
+
+            auto shade = [&](const typename Planes::Row &row, int x, unsigned int) { return shadeFragment(m_shader, row, x); };
+            if(m_materializeFragments && Mode == PassMode::Color) {
+                // the fragments are kept for debugging, so they are never binned
+                FragmentList output {*outFrs};
+                rasterPrimitives<Planes>(width, height, output, shade);
+            }
+            else if(m_binned) {
+                // fragments go straight to the frame buffer, one tile at a time
+                binPrimitives(width, height);
+                rasterBins<Planes, Mode>(fb, db, [&](const typename Planes::Row &row, int x, unsigned int i) { return shade(row, x, i).getRGBA32(); });
+            }
+            else {
+                withFrameBufferWriter<Mode>(fb, db, &stats(), [&](auto &output) { rasterPrimitives<Planes>(width, height, output, shade); });
+            }
+            SRL_STATS(clock.lap(PipelineStats::RASTERIZATION));
         }
 
-        // 2.1. create triangle primitives
-        void assemblePrimitives(const std::vector<vertex> &vts) {
-            m_primitives.clear();
+        // shade the draws of the frame that used the visibility buffer
+        void processEndFrame() override {
+            if(m_visibilityTarget)
+                resolveVisibility();
+        }
+
+        // recompute the parts of the depth pyramid covered by the triangles we just drew
+        void processDepthBufferWritten(FrameBuffer <float> &db) override {
+            if(m_hierarchicalZ) m_hiZ.update(db);
+        }
+
+        // 2.1. create triangle primitives, without varyings the vertices only get their position
+        void assemblePrimitives(const VertexStream<Varyings> &vts, bool varyings) {
+            arena().prepare(m_primitives);
             m_primitives.reserve(vts.size()/3);
 
             for(int i = 0, size = vts.size()-2; i < size; i+=3){
-                triangle t;
-                t.v1 = vts[i];
-                t.v2 = vts[i+1];
-                t.v3 = vts[i+2];
+                triangle<Vertex> t;
+                if(varyings) {
+                    t.v1 = vts[i];
+                    t.v2 = vts[i+1];
+                    t.v3 = vts[i+2];
+                }
+                else {
+                    t.v1 = Vertex(vts.position(i), Varyings());
+                    t.v2 = Vertex(vts.position(i+1), Varyings());
+                    t.v3 = Vertex(vts.position(i+2), Varyings());
+                }
 
                 m_primitives.push_back(t);
             }
@@ -64,9 +358,87 @@ namespace srl {
 
 
         // 2.2. clip primitives so that they are contained within the render volume
-        void clipPrimitives() {
-            // TODO Exercise 7.1 - implement triangle clipping
+        void clipPrimitives(const VertexStream<Varyings> &vts) {
+            // a plane (a, b, c, d) keeps the positions where a*x + b*y + c*z + d*w >= 0
+            const glm::vec4 planes[6] = {
+                glm::vec4(0, 0, 1, 1), glm::vec4(0, 0, -1, 1),                   // near, far
+                glm::vec4(1, 0, 0, m_guardBand), glm::vec4(-1, 0, 0, m_guardBand), // guard band left, right
+                glm::vec4(0, 1, 0, m_guardBand), glm::vec4(0, -1, 0, m_guardBand)  // guard band bottom, top
+            };
+
+            // the polygon grows by at most one vertex per plane
+            Vertex polygon[MAX_CLIPPED_VERTICES], clipped[MAX_CLIPPED_VERTICES];
+
+            // triangles created by clipping are added at the end, and do not need to be clipped again
+            for(int i = 0, size = m_primitives.size(); i < size; i++) {
+                // triangle i was assembled from vertices 3i, 3i+1 and 3i+2 of the stream
+                uint8_t c1 = vts.outcode(3*i), c2 = vts.outcode(3*i + 1), c3 = vts.outcode(3*i + 2);
+
+                // already culled, or all the vertices are inside of the view volume
+                if(m_primitives[i].rejected || (c1 | c2 | c3) == 0)
+                    continue;
 
+                triangle<Vertex> tri = m_primitives[i];
+                polygon[0] = tri.v1; polygon[1] = tri.v2; polygon[2] = tri.v3;
+                int count = 3;
+
+                // which planes do we need to clip against
+                bool clipPlane[6] = {
+                    ((c1 | c2 | c3) & OUT_NEAR) != 0, ((c1 | c2 | c3) & OUT_FAR) != 0,
+                    false, false, false, false
+                };
+                for(int plane = 2; plane < 6; plane++)
+                    for(int v = 0; v < 3; v++)
+                        clipPlane[plane] |= planeDistance(planes[plane], polygon[v].pos) < 0;
+
+                for(int plane = 0; plane < 6 && count >= 3; plane++) {
+                    if(!clipPlane[plane])
+                        continue;
+                    count = clipPolygon(polygon, count, planes[plane], clipped);
+                    std::copy(clipped, clipped + count, polygon);
+                }
+
+                if(count < 3) {
+                    m_primitives[i].rejected = true;
+                    SRL_STATS(stats().primitivesRejected++;)
+                    continue;
+                }
+                // only the triangles that were cut count as clipped, not the ones inside the guard band
+                SRL_STATS(stats().primitivesClipped += std::find(clipPlane, clipPlane + 6, true) != clipPlane + 6;)
+
+                // triangle fan, the first triangle replaces the original one
+                tri.v1 = polygon[0]; tri.v2 = polygon[1]; tri.v3 = polygon[2];
+                m_primitives[i] = tri;
+                for(int v = 3; v < count; v++) {
+                    tri.v2 = polygon[v - 1];
+                    tri.v3 = polygon[v];
+                    m_primitives.push_back(tri);
+                }
+            }
+        }
+
+        // signed distance (times the length of the plane normal) of a clip space position to a plane
+        static float planeDistance(const glm::vec4 &plane, const glm::vec4 &pos) {
+            return plane.x * pos.x + plane.y * pos.y + plane.z * pos.z + plane.w * pos.w;
+        }
+
+        // Sutherland-Hodgman, clip the polygon in (with count vertices) against a plane and store the result
+        // in out. Returns the number of vertices of the clipped polygon
+        static int clipPolygon(const Vertex *in, int count, const glm::vec4 &plane, Vertex *out) {
+            int outCount = 0;
+            for(int v = 0; v < count; v++) {
+                const Vertex &a = in[v];
+                const Vertex &b = in[(v + 1) % count];
+                float da = planeDistance(plane, a.pos);
+                float db = planeDistance(plane, b.pos);
+
+                // keep the vertices inside, and add a vertex where the edge crosses the plane
+                if(da >= 0)
+                    out[outCount++] = a;
+                if((da >= 0) != (db >= 0))
+                    out[outCount++] = a + (b - a) * (da / (da - db));
+            }
+            return outCount;
         }
 
         // 2.3. perspective division (canonical perspective volume to normalized device coordinates)
@@ -81,55 +453,443 @@ namespace srl {
 
         // 2.4. normalized device coordinates to screen space
         void toScreenSpace(int width, int height)  {
-            float halfW = width / 2;
-            float halfH = width / 2;
-            glm::mat4 toWindowSpace = glm::scale(halfW, halfH, 1.f) * glm::translate(1.f, 1.f, 0.f);
+            float halfW = width / 2.f;
+            float halfH = height / 2.f;
             for(auto &tri : m_primitives) {
-                tri.v1.pos = toWindowSpace * tri.v1.pos;
-                tri.v2.pos = toWindowSpace * tri.v2.pos;
-                tri.v3.pos = toWindowSpace * tri.v3.pos;
+                tri.v1.pos = toWindowSpace(tri.v1.pos, halfW, halfH);
+                tri.v2.pos = toWindowSpace(tri.v2.pos, halfW, halfH);
+                tri.v3.pos = toWindowSpace(tri.v3.pos, halfW, halfH);
             }
         }
 
+        // normalized device coordinates (x, y in [-1, 1]) to window coordinates (x in [0, width], y in [0, height]),
+        // the same as multiplying by glm::scale(halfW, halfH, 1) * glm::translate(1, 1, 0). Written out so that
+        // cullPrimitives gets exactly the positions the rasterizers will see
+        static inline glm::vec4 toWindowSpace(const glm::vec4 &ndc, float halfW, float halfH) {
+            return glm::vec4(ndc.x * halfW + halfW * ndc.w, ndc.y * halfH + halfH * ndc.w, ndc.z, ndc.w);
+        }
+
+        // 2.5. reject, in clip space, the triangles that
+        //  - are outside of one of the planes of the view volume (all vertices have the same outcode bit),
+        //  - face away from the camera (m_cullBackFaces), triangles are front facing in clockwise order on the
+        //    screen, the winding of the models of these exercises (e.g. cubeIndices in models.h),
+        //  - cover no pixel center: the rasterizers snap the vertices to the pixel grid, and generate nothing
+        //    if the snapped vertices are in a line (e.g. all of them in the same pixel).
+        // Clip space (x, y, w) is a perspective view of screen space from the eye, so the sign of the determinant
+        // of the (x, y, w) of the three vertices is the orientation of the triangle on the screen, no matter if
+        // the triangle crosses the plane of the eye (Olano and Greer, 2D homogeneous rasterization). The snapped
+        // area is only computed for triangles inside of the view volume, the others still need to be clipped
+        void cullPrimitives(const VertexStream<Varyings> &vts, int width, int height) {
+            float halfW = width / 2.f;
+            float halfH = height / 2.f;
+            SRL_STATS(uint64_t rejected = 0; uint64_t culled = 0; uint64_t degenerate = 0;)
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                triangle<Vertex> &tri = m_primitives[i];
+
+                // all the vertices are outside of the same plane
+                if(vts.outcode(3*i) & vts.outcode(3*i + 1) & vts.outcode(3*i + 2)) {
+                    tri.rejected = true;
+                    SRL_STATS(rejected++;)
+                    continue;
+                }
 
-        // 2.5. only draw triangles in a counterclockwise winding order and facing the camera
-        void backfaceCulling(){
-            // TODO Exercise 7.2 - implement backface culling
+                const glm::vec4 &p1 = tri.v1.pos, &p2 = tri.v2.pos, &p3 = tri.v3.pos;
+                if(m_cullBackFaces) {
+                    float det = p1.x * (p2.y * p3.w - p3.y * p2.w) - p1.y * (p2.x * p3.w - p3.x * p2.w) +
+                                p1.w * (p2.x * p3.y - p3.x * p2.y);
+                    if(det > 0) {
+                        tri.rejected = true;
+                        SRL_STATS(culled++;)
+                        continue;
+                    }
+                }
 
+                bool inside = (vts.outcode(3*i) | vts.outcode(3*i + 1) | vts.outcode(3*i + 2)) == 0;
+                if(inside && p1.w > 0 && p2.w > 0 && p3.w > 0) {
+                    // same arithmetic as divideByW and toScreenSpace, and the snapping of the rasterizers
+                    int x[3], y[3];
+                    const glm::vec4 *p[3] = {&p1, &p2, &p3};
+                    for(int v = 0; v < 3; v++) {
+                        glm::vec4 window = toWindowSpace(glm::vec4(p[v]->x / p[v]->w, p[v]->y / p[v]->w, 0.f, p[v]->w / p[v]->w), halfW, halfH);
+                        x[v] = int(window.x + .5f);
+                        y[v] = int(window.y + .5f);
+                    }
+                    int64_t area = int64_t(x[1] - x[0]) * (y[2] - y[0]) - int64_t(y[1] - y[0]) * (x[2] - x[0]);
+                    if(area == 0) {
+                        tri.rejected = true;
+                        SRL_STATS(degenerate++;)
+                        continue;
+                    }
+                }
+            }
+            SRL_STATS(stats().primitivesRejected += rejected; stats().primitivesCulled += culled; stats().primitivesDegenerate += degenerate;)
         }
 
-        // 2.6. rasterization (generate fragments)
-        void rasterPrimitives(std::vector<fragment> &frs) {
-            frs.clear();
-
-            for(auto &tri : m_primitives) {
+        // 2.6. rasterization (generate fragments and send them to output). value(row, x, i) is what is written for
+        // pixel x of a row of triangle i, a color or a value (e.g. the id of the triangle). Only the
+        // fragments that pass the test compute it
+        template<class TriPlanes, class Output, class Value>
+        void rasterPrimitives(int width, int height, Output &output, Value &&value) {
+            SRL_STATS(uint64_t generated = 0;)
+            for(unsigned int i = 0, size = m_primitives.size(); i < size; i++) {
+                const triangle<Vertex> &tri = m_primitives[i];
                 // skip this primitive
                 if(tri.rejected)
                     continue;
 
-                // create primitive rasterizer
-                triangle_rasterizer rasterizer(tri.v1, tri.v2, tri.v3);
+                if(m_hierarchicalZ) {
+                    // skip the triangle if it is behind the depth buffer in its whole bounding box
+                    int x0, y0, x1, y1;
+                    if(!boundingBox(tri, 0, 0, width - 1, height - 1, x0, y0, x1, y1) || hiddenByHiZ(tri, x0, y0, x1, y1)) {
+                        SRL_STATS(stats().primitivesOccluded++;)
+                        continue;
+                    }
+                    m_hiZ.invalidate(x0, y0, x1, y1);
+                }
+
+                // generate the fragments inside the screen, only the ones that pass the test interpolate the varyings
+                TriPlanes planes(tri.v1, tri.v2, tri.v3);
+                rasterTriangle(tri, 0, 0, width - 1, height - 1, [&](int y, int xBegin, int xEnd) {
+                    SRL_STATS(generated += xEnd - xBegin + 1;)
+                    typename TriPlanes::Row row = planes.row(y);
+                    for (int x = xBegin; x <= xEnd; x++) {
+                        float depth = row.depth(x);
+                        if (output.test(x, y, depth))
+                            output.write(x, y, depth, value(row, x, i));
+                    }
+                });
+            }
+            SRL_STATS(stats().fragmentsGenerated += generated;)
+        }
+
+        // 2.6. call span(y, xBegin, xEnd) for each run of pixels [xBegin, xEnd] of row y of the triangle inside the
+        // rectangle [x0, x1] x [y0, y1]. The rasterizers only compute the coverage, the attributes are interpolated
+        // with TrianglePlanes
+        template<class Span>
+        void rasterTriangle(const triangle<Vertex> &tri, int x0, int y0, int x1, int y1, Span &&span) const {
+            if (m_rasterMode == RasterMode::HalfSpace) {
+                halfspace_rasterizer rasterizer(tri.v1.pos, tri.v2.pos, tri.v3.pos, x0, y0, x1, y1);
+                halfspace_rasterizer::block blk;
+                // both use 8x8 blocks aligned to the screen, so the rasterizer can test its blocks against the pyramid
+                static_assert(halfspace_rasterizer::BLOCK_SIZE == DepthPyramid::BLOCK_SIZE, "block sizes must match");
+                if (m_hierarchicalZ)
+                    rasterizer.set_depth_bounds(m_hiZ.blockMaxDepths(), m_hiZ.blocksX());
+
+                const int size = halfspace_rasterizer::BLOCK_SIZE;
+                while (rasterizer.next_block(blk)) {
+                    for (int j = 0; j < size; j++) {
+                        unsigned int rowMask = unsigned(blk.mask >> (j * size)) & ((1u << size) - 1);
+                        // the pixels of a triangle in a row are contiguous, but look for every run anyway
+                        for (int i = 0; rowMask >> i; ) {
+                            while (!(rowMask >> i & 1u)) i++;
+                            int begin = i;
+                            while (rowMask >> i & 1u) i++;
+                            span(blk.y + j, blk.x + begin, blk.x + i - 1);
+                        }
+                    }
+                }
+            }
+            else {
+                triangle_rasterizer rasterizer(tri.v1.pos, tri.v2.pos, tri.v3.pos, x0, y0, x1, y1);
 
-                // generate the fragments
                 while (rasterizer.more_fragments()) {
-                    srl::fragment frag;
-                    frag.posX = rasterizer.x();
-                    frag.posY = rasterizer.y();
+                    span(rasterizer.y(), rasterizer.x(), rasterizer.x_end());
+                    rasterizer.next_span();
+                }
+            }
+        }
+
+        // run the fragment shader for pixel x of a row of the triangle, with the derivatives of the varyings if the
+        // shader uses them
+        static inline color shadeFragment(const Shader &shader, const typename Planes::Row &row, int x) {
+            return shadeFragment(shader, row, x, usesDerivatives<Shader>());
+        }
+        static inline color shadeFragment(const Shader &shader, const typename Planes::Row &row, int x, std::false_type) {
+            return shader.shadeFragment(row.varyings(x));
+        }
+        static inline color shadeFragment(const Shader &shader, const typename Planes::Row &row, int x, std::true_type) {
+            Varyings ddx, ddy;
+            Varyings in = row.varyings(x, ddx, ddy);
+            return shader.shadeFragment(in, ddx, ddy);
+        }
+
+        // bounding box of the triangle in pixels, rounded the same way as in the rasterizer and clipped by the
+        // rectangle [rx0, rx1] x [ry0, ry1]. Returns false if it is empty
+        bool boundingBox(const triangle<Vertex> &tri, int rx0, int ry0, int rx1, int ry1, int &x0, int &y0, int &x1, int &y1) const {
+            x0 = std::max(rx0, int(std::min({tri.v1.pos.x, tri.v2.pos.x, tri.v3.pos.x}) + .5f));
+            x1 = std::min(rx1, int(std::max({tri.v1.pos.x, tri.v2.pos.x, tri.v3.pos.x}) + .5f));
+            y0 = std::max(ry0, int(std::min({tri.v1.pos.y, tri.v2.pos.y, tri.v3.pos.y}) + .5f));
+            y1 = std::min(ry1, int(std::max({tri.v1.pos.y, tri.v2.pos.y, tri.v3.pos.y}) + .5f));
+            return x0 <= x1 && y0 <= y1;
+        }
+
+        // true if the nearest vertex of the triangle is not closer than the farthest depth in [x0, x1] x [y0, y1]
+        bool hiddenByHiZ(const triangle<Vertex> &tri, int x0, int y0, int x1, int y1) const {
+            // interpolating in float may give fragments a bit closer than the nearest vertex
+            const float epsilon = 1e-5f;
+            float nearest = std::min({tri.v1.pos.z, tri.v2.pos.z, tri.v3.pos.z});
+            return m_hiZ.occluded(x0, y0, x1, y1, nearest - epsilon);
+        }
+
+        // 2.6. (binned) sort the triangles into the screen tiles they overlap. The bins are stored one after
+        // the other in m_binTriangles, bin t goes from m_binStart[t] to m_binStart[t+1]
+        void binPrimitives(int width, int height) {
+            m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+            m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+            unsigned int tiles = m_tilesX * m_tilesY;
+            arena().prepare(m_binStart);
+            arena().prepare(m_binTriangles);
+            m_binStart.resize(tiles + 1, 0);
+
+            // call visit(tile) for every tile overlapped by the bounding box of the triangle
+            auto forTiles = [&](const triangle<Vertex> &tri, auto &&visit) {
+                int x0, y0, x1, y1;
+                if (tri.rejected || !boundingBox(tri, 0, 0, width - 1, height - 1, x0, y0, x1, y1))
+                    return;
+                for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+                    for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+                        visit(ty * m_tilesX + tx);
+            };
+
+            // count the triangles of each tile, and turn the counts into the start of each bin
+            for (const triangle<Vertex> &tri : m_primitives)
+                forTiles(tri, [&](unsigned int tile) { m_binStart[tile + 1]++; });
+            for (unsigned int tile = 0; tile < tiles; tile++)
+                m_binStart[tile + 1] += m_binStart[tile];
+
+            // fill the bins in submission order, using m_binStart[t] as the insertion point of bin t
+            m_binTriangles.resize(m_binStart[tiles]);
+            for (unsigned int i = 0, size = m_primitives.size(); i < size; i++)
+                forTiles(m_primitives[i], [&](unsigned int tile) { m_binTriangles[m_binStart[tile]++] = i; });
+            // each insertion point ended at the start of the next bin, shift them back
+            for (unsigned int tile = tiles; tile > 0; tile--)
+                m_binStart[tile] = m_binStart[tile - 1];
+            m_binStart[0] = 0;
+        }
 
-                    vertex vtx = rasterizer.getCurrent();
-                    frag.depth = vtx.pos.z;
-                    vtx = vtx/vtx.one; // hyperbolic interpolation
-                    frag.col = vtx.col;
+        // 2.6. (binned) rasterize every tile in parallel, each tile is read and written to the frame buffer once.
+        // value(row, x, i) is the 32 bits written to fb for pixel x of a row of triangle i, see rasterPrimitives.
+        // Mode is what is tested and written (fb is nullptr for DepthOnly), only the buffers written are loaded
+        template<class TriPlanes, PassMode Mode, class Value>
+        void rasterBins(FrameBuffer <uint32_t> *fb, FrameBuffer <float> &db, Value &&value) {
+            int width = db.width();
+            int height = db.height();
+            // the tiles add their counts once they are done
+            SRL_STATS(std::atomic<uint64_t> occluded {0}, generated {0}, depthFailed {0}, written {0};)
+
+            ThreadPool::shared().parallelFor(m_tilesX * m_tilesY, [&](unsigned int tile, unsigned int) {
+                const unsigned int *binBegin = m_binTriangles.data() + m_binStart[tile];
+                const unsigned int *binEnd = m_binTriangles.data() + m_binStart[tile + 1];
+                if (binBegin == binEnd)
+                    return;
+
+                // tile rectangle in pixels
+                int x0 = (tile % m_tilesX) * TILE_SIZE, y0 = (tile / m_tilesX) * TILE_SIZE;
+                int x1 = std::min(x0 + TILE_SIZE, width) - 1, y1 = std::min(y0 + TILE_SIZE, height) - 1;
+
+                // local copy of the tile, small enough to stay in cache while we rasterize. If the frame buffer
+                // was fast cleared, the cleared parts of the tile are not read, and they are only written once, below.
+                // Tiles do not share clear tiles, so they can be loaded and stored in parallel
+                static_assert(TILE_SIZE % FrameBuffer<float>::CLEAR_TILE_SIZE == 0, "tiles must not share clear tiles");
+                uint32_t colors[TILE_SIZE * TILE_SIZE];
+                float depths[TILE_SIZE * TILE_SIZE];
+                if (Mode != PassMode::DepthOnly)
+                    fb->loadRect(x0, y0, x1, y1, colors, TILE_SIZE);
+                db.loadRect(x0, y0, x1, y1, depths, TILE_SIZE);
+
+                SRL_STATS(uint64_t tileOccluded = 0, tileGenerated = 0, tileWritten = 0;)
+                // triangles are in submission order, so depth ties resolve the same way as in rasterPrimitives
+                for (const unsigned int *bin = binBegin; bin != binEnd; bin++) {
+                    unsigned int i = *bin;
+                    // the pyramid holds the depth at the start of this draw call, so it stays conservative
+                    int bx0, by0, bx1, by1;
+                    if (m_hierarchicalZ && (!boundingBox(m_primitives[i], x0, y0, x1, y1, bx0, by0, bx1, by1) ||
+                                            hiddenByHiZ(m_primitives[i], bx0, by0, bx1, by1))) {
+                        SRL_STATS(tileOccluded++;)
+                        continue;
+                    }
+
+                    TriPlanes planes(m_primitives[i].v1, m_primitives[i].v2, m_primitives[i].v3);
+                    rasterTriangle(m_primitives[i], x0, y0, x1, y1, [&](int y, int xBegin, int xEnd) {
+                        SRL_STATS(tileGenerated += xEnd - xBegin + 1;)
+                        typename TriPlanes::Row row = planes.row(y);
+                        float *rowDepths = depths + (y - y0) * TILE_SIZE - x0;
+                        if (Mode == PassMode::DepthOnly) {
+                            // the closest depth, without branches
+                            for (int x = xBegin; x <= xEnd; x++) {
+                                float depth = row.depth(x);
+                                SRL_STATS(tileWritten += depth < rowDepths[x];)
+                                rowDepths[x] = depth < rowDepths[x] ? depth : rowDepths[x];
+                            }
+                            return;
+                        }
+                        uint32_t *rowColors = colors + (y - y0) * TILE_SIZE - x0;
+                        for (int x = xBegin; x <= xEnd; x++) {
+                            float depth = row.depth(x);
+                            if (Mode == PassMode::EqualDepth ? depth == rowDepths[x] : depth < rowDepths[x]) {
+                                rowColors[x] = value(row, x, i);
+                                if (Mode != PassMode::EqualDepth)
+                                    rowDepths[x] = depth;
+                                SRL_STATS(tileWritten++;)
+                            }
+                        }
+                    });
+                }
+                SRL_STATS(occluded += tileOccluded; generated += tileGenerated; written += tileWritten;
+                          depthFailed += tileGenerated - tileWritten;)
+
+                // write the tile back
+                if (Mode != PassMode::DepthOnly)
+                    fb->storeRect(x0, y0, x1, y1, colors, TILE_SIZE);
+                if (Mode != PassMode::EqualDepth)
+                    db.storeRect(x0, y0, x1, y1, depths, TILE_SIZE);
+
+                // update the level 0 blocks of the pyramid while the tile is still in cache
+                if (m_hierarchicalZ && Mode != PassMode::EqualDepth)
+                    updateHiZBlocks(depths, x0, y0, x1, y1);
+            });
+
+            SRL_STATS(stats().primitivesOccluded += occluded; stats().fragmentsGenerated += generated;
+                      stats().fragmentsDepthFailed += depthFailed; stats().fragmentsWritten += written;)
+
+            // the levels above are updated (once per draw call) in processDepthBufferWritten
+            if (m_hierarchicalZ)
+                for (int tile = 0; tile < m_tilesX * m_tilesY; tile++)
+                    if (m_binStart[tile] != m_binStart[tile + 1]) {
+                        int x0 = (tile % m_tilesX) * TILE_SIZE, y0 = (tile / m_tilesX) * TILE_SIZE;
+                        m_hiZ.invalidateParents(x0, y0, x0 + TILE_SIZE - 1, y0 + TILE_SIZE - 1);
+                    }
+        }
 
-                    frs.push_back(frag);
-                    rasterizer.next_fragment();
+        // 2.6. (binned) set the min and max depth of the pyramid blocks of the tile [x0, x1] x [y0, y1]
+        void updateHiZBlocks(const float *depths, int x0, int y0, int x1, int y1) {
+            const int block = DepthPyramid::BLOCK_SIZE;
+            for (int by = y0; by <= y1; by += block)
+                for (int bx = x0; bx <= x1; bx += block) {
+                    float minDepth = depths[(by - y0) * TILE_SIZE + (bx - x0)], maxDepth = minDepth;
+                    for (int y = by; y <= std::min(by + block - 1, y1); y++)
+                        for (int x = bx; x <= std::min(bx + block - 1, x1); x++) {
+                            float depth = depths[(y - y0) * TILE_SIZE + (x - x0)];
+                            minDepth = std::min(minDepth, depth);
+                            maxDepth = std::max(maxDepth, depth);
+                        }
+                    m_hiZ.setBlock(bx / block, by / block, minDepth, maxDepth);
                 }
+        }
+
+        // start or continue the visibility buffer of the frame with the triangles of this draw call, and return the id
+        // of the first one. Id i + 1 is triangle i of m_visibleTriangles, 0 is a pixel nothing was drawn to
+        unsigned int beginVisibility(FrameBuffer <uint32_t> &fb) {
+            // a frame that was not ended is dropped, its triangles were released with the frame arena
+            if(m_visibilityTarget && m_visibilityGeneration != this->frameArena().generation())
+                m_visibilityTarget = nullptr;
+            // another color buffer, shade what we have first
+            if(m_visibilityTarget && m_visibilityTarget != &fb)
+                resolveVisibility();
+
+            if(!m_visibilityTarget) {
+                // ids use the layout of the depth buffer, which is the same as the one of fb
+                if(!m_visibility || m_visibility->width() != fb.width() || m_visibility->height() != fb.height() ||
+                   m_visibility->layout() != fb.layout())
+                    m_visibility.reset(new FrameBuffer<uint32_t>(fb.width(), fb.height(), fb.layout()));
+                m_visibility->fastClear(0);
+                arena().prepare(m_visibleTriangles);
+                arena().prepare(m_visibleDraws);
+                m_drawShaders.clear();
+                m_visibilityTarget = &fb;
+                m_visibilityGeneration = this->frameArena().generation();
             }
+
+            unsigned int firstId = m_visibleTriangles.size() + 1;
+            m_visibleTriangles.insert(m_visibleTriangles.end(), m_primitives.begin(), m_primitives.end());
+            m_visibleDraws.resize(m_visibleTriangles.size(), m_drawShaders.size());
+            m_drawShaders.push_back(m_shader);
+            return firstId;
         }
 
+        // 3. (visibility buffer) shade each pixel of the visibility buffer once, with the shader of the draw call
+        // of its triangle. The planes of the triangle are set up again for each run of pixels of a row with the
+        // same triangle. The tiles are shaded in parallel
+        void resolveVisibility() {
+            SRL_STATS(StageClock clock(stats()));
+            FrameBuffer <uint32_t> &fb = *m_visibilityTarget;
+            int width = fb.width(), height = fb.height();
+            int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE, tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+            ThreadPool::shared().parallelFor(tilesX * tilesY, [&](unsigned int tile, unsigned int) {
+                int x0 = (tile % tilesX) * TILE_SIZE, y0 = (tile / tilesX) * TILE_SIZE;
+                int x1 = std::min(x0 + TILE_SIZE, width) - 1, y1 = std::min(y0 + TILE_SIZE, height) - 1;
+
+                // local copies of the tile, as in rasterBins
+                uint32_t ids[TILE_SIZE * TILE_SIZE];
+                m_visibility->loadRect(x0, y0, x1, y1, ids, TILE_SIZE);
+                bool drawn = false;
+                for (int y = y0; y <= y1 && !drawn; y++)
+                    for (int x = x0; x <= x1 && !drawn; x++)
+                        drawn = ids[(y - y0) * TILE_SIZE + (x - x0)] != 0;
+                if (!drawn)
+                    return;
+                uint32_t colors[TILE_SIZE * TILE_SIZE];
+                fb.loadRect(x0, y0, x1, y1, colors, TILE_SIZE);
+
+                for (int y = y0; y <= y1; y++) {
+                    const uint32_t *rowIds = ids + (y - y0) * TILE_SIZE - x0;
+                    uint32_t *rowColors = colors + (y - y0) * TILE_SIZE - x0;
+                    for (int x = x0, xEnd; x <= x1; x = xEnd + 1) {
+                        uint32_t id = rowIds[x];
+                        for (xEnd = x; xEnd < x1 && rowIds[xEnd + 1] == id; xEnd++);
+                        if (id == 0)
+                            continue;
+
+                        const triangle<Vertex> &tri = m_visibleTriangles[id - 1];
+                        const Shader &shader = m_drawShaders[m_visibleDraws[id - 1]];
+                        Planes planes(tri.v1, tri.v2, tri.v3);
+                        typename Planes::Row row = planes.row(y);
+                        for (int px = x; px <= xEnd; px++)
+                            rowColors[px] = shadeFragment(shader, row, px).getRGBA32();
+                    }
+                }
+                fb.storeRect(x0, y0, x1, y1, colors, TILE_SIZE);
+            });
+            SRL_STATS(clock.lap(PipelineStats::FRAGMENT));
+
+            m_visibilityTarget = nullptr;
+            m_drawShaders.clear();
+        }
+
+        // a triangle clipped by the six planes of the view volume has at most 3 + 6 vertices
+        static const int MAX_CLIPPED_VERTICES = 9;
+
         // list of triangle primitives.
-        std::vector<triangle> m_primitives;
+        ArenaVector<triangle<Vertex> > m_primitives;
+
+        // indices of the triangles overlapping each screen tile (binned rasterization)
+        ArenaVector<unsigned int> m_binStart;
+        ArenaVector<unsigned int> m_binTriangles;
+        int m_tilesX = 0, m_tilesY = 0;
+
+        // min/max depth of blocks of the depth buffer (hierarchical z)
+        DepthPyramid m_hiZ;
+
+        // visibility buffer: ids of the triangles in each pixel, the color buffer they are shaded to (nullptr when
+        // nothing is pending) and the frame they were drawn in, the triangles of the frame, the draw call of each
+        // one, and the shader of each draw call
+        std::unique_ptr<FrameBuffer <uint32_t> > m_visibility;
+        FrameBuffer <uint32_t> *m_visibilityTarget = nullptr;
+        unsigned int m_visibilityGeneration = 0;
+        ArenaVector<triangle<Vertex> > m_visibleTriangles;
+        ArenaVector<unsigned int> m_visibleDraws;
+        std::vector<Shader> m_drawShaders;
+
+        // scratch of occlusionQuery, the first and last pixel of each row of the silhouette, and a row of depths
+        std::vector<int> m_queryRows;
+        std::vector<float> m_queryDepths;
     };
+
+    template<class Shader>
+    const int BasicTriangleRenderer<Shader>::TILE_SIZE;
+
+    typedef BasicTriangleRenderer<ColorShader> TriangleRenderer;
 };
 
 
@@ -8,9 +8,6 @@
 #include <glm/glm.hpp>
 
 namespace srl {
-    struct point;
-    struct line;
-    struct triangle;
 
     struct color{
         // NEW!
@@ -30,21 +27,30 @@ namespace srl {
             return (uint32_t(255*r)) | (uint32_t(255*g) << 8) |
                    (uint32_t(255*b) << 16) | (uint32_t(255*a) << 24);
         }
+
+        // so that colors can be interpolated as varyings
+        friend color operator/ (color c, float sc){ c.r /= sc; c.g /= sc; c.b /= sc; c.a /= sc; return c; }
+        friend color operator* (color c, float sc){ c.r *= sc; c.g *= sc; c.b *= sc; c.a *= sc; return c; }
+        friend color operator- (color c1, const color &c2){ c1.r -= c2.r; c1.g -= c2.g; c1.b -= c2.b; c1.a -= c2.a; return c1; }
+        friend color operator+ (color c1, const color &c2){ c1.r += c2.r; c1.g += c2.g; c1.b += c2.b; c1.a += c2.a; return c1; }
     };
 
-    // vertex definition, you can think of that as the in and out variables of the vertex shader
+    // vertex definition, you can think of that as the in variables of the vertex shader
     struct vertex {
 
         glm::vec4 pos;
         color col;
+        // texture coordinates, (0, 0) and (1, 1) are opposite corners of the texture (see srl_texture.h)
+        glm::vec2 uv;
         float one;
 
 
-        vertex() : one(1.0f) {}
+        vertex() : uv(0.0f), one(1.0f) {}
 
         friend vertex operator/ (vertex v, float sc){
             v.pos /= sc;
             v.col.r /= sc; v.col.g /= sc; v.col.b /= sc; v.col.a /= sc;
+            v.uv /= sc;
             v.one /= sc;
             return v;
         }
@@ -52,6 +58,7 @@ namespace srl {
         friend vertex operator* (vertex v, float sc){
             v.pos *= sc;
             v.col.r *= sc; v.col.g *= sc; v.col.b *= sc; v.col.a *= sc;
+            v.uv *= sc;
             v.one *= sc;
             return v;
         }
@@ -59,6 +66,7 @@ namespace srl {
         friend vertex operator- (vertex v1, const vertex &v2){
             v1.pos -= v2.pos;
             v1.col.r -= v2.col.r; v1.col.g -= v2.col.g; v1.col.b -= v2.col.b; v1.col.a -= v2.col.a;
+            v1.uv -= v2.uv;
             v1.one -= v2.one;
             return v1;
         }
@@ -66,32 +74,80 @@ namespace srl {
         friend vertex operator+ (vertex v1, const vertex &v2){
             v1.pos += v2.pos;
             v1.col.r += v2.col.r; v1.col.g += v2.col.g; v1.col.b += v2.col.b; v1.col.a += v2.col.a;
+            v1.uv += v2.uv;
+            v1.one += v2.one;
+            return v1;
+        }
+
+    };
+
+    // vertex after the vertex shader, what goes through primitive assembly, clipping and rasterization.
+    // Varyings are the outputs of the vertex shader that are interpolated across the primitive, they need the
+    // same operators as vertex (see Shader in srl_shader.h)
+    template<class Varyings>
+    struct shaded_vertex {
+
+        glm::vec4 pos;
+        Varyings var;
+        float one;
+
+
+        shaded_vertex() : one(1.0f) {}
+        shaded_vertex(const glm::vec4 &pos, const Varyings &var) : pos(pos), var(var), one(1.0f) {}
+
+        friend shaded_vertex operator/ (shaded_vertex v, float sc){
+            v.pos /= sc;
+            v.var = v.var / sc;
+            v.one /= sc;
+            return v;
+        }
+
+        friend shaded_vertex operator* (shaded_vertex v, float sc){
+            v.pos *= sc;
+            v.var = v.var * sc;
+            v.one *= sc;
+            return v;
+        }
+
+        friend shaded_vertex operator- (shaded_vertex v1, const shaded_vertex &v2){
+            v1.pos -= v2.pos;
+            v1.var = v1.var - v2.var;
+            v1.one -= v2.one;
+            return v1;
+        }
+
+        friend shaded_vertex operator+ (shaded_vertex v1, const shaded_vertex &v2){
+            v1.pos += v2.pos;
+            v1.var = v1.var + v2.var;
             v1.one += v2.one;
             return v1;
         }
 
     };
 
-    // primitives
+    // primitives, of vertex or shaded_vertex
+    template<class Vertex>
     struct point{
-        vertex v;
+        Vertex v;
         bool rejected = false;
     };
 
+    template<class Vertex>
     struct triangle{
-        vertex v1;
-        vertex v2;
-        vertex v3;
+        Vertex v1;
+        Vertex v2;
+        Vertex v3;
         bool rejected = false;
     };
 
+    template<class Vertex>
     struct line {
-        vertex v1;
-        vertex v2;
+        Vertex v1;
+        Vertex v2;
         bool rejected = false;
     };
 
-    // fragment definition, you can think of that as the in and out variables of the fragment shader
+    // fragment definition, a fragment with the color given by the fragment shader
     struct fragment {
         color col;
         int posX;